@@ -28,7 +28,7 @@ exists(version.txt) {
 	VERSION = $$cat(version.txt)
 }
 
-QT  += core gui openglwidgets concurrent
+QT  += core gui openglwidgets concurrent network
 
 CONFIG += c++17
 TARGET = rapcad
@@ -47,12 +47,14 @@ win32 {
 	INCLUDEPATH += $$(CGAL_DIR)/auxiliary/gmp/include
 	INCLUDEPATH += $$(BOOST_ROOT)
 	INCLUDEPATH += $$(LIBGIT2_DIR)/include
+	INCLUDEPATH += $$(ZLIB_DIR)/include
 	LIBS += -L$$(CGAL_DIR)/lib
 	exists( $$(CGAL_DIR)/lib/libCGAL* ) {
 		LIBS +=  -lCGAL -lCGAL_Core
 	}
 	LIBS += -L$$(CGAL_DIR)/auxiliary/gmp/lib -lmpfr-4 -lgmp-10
 	LIBS += -L$$(LIBGIT2_DIR)/lib -lgit2
+	LIBS += -L$$(ZLIB_DIR)/lib -lz
 	LIBS += -lglu32
 	contains(DEFINES,USE_READLINE) {
 	LIBS += -lreadline
@@ -69,7 +71,7 @@ win32 {
 	exists( /usr/lib/i386-linux-gnu/libCGAL* ) {
 		LIBS += -lCGAL -lCGAL_Core
 	}
-	LIBS += -lmpfr -lgmp -lgmpxx
+	LIBS += -lmpfr -lgmp -lgmpxx -lz
 	contains(DEFINES,USE_READLINE) {
 	LIBS+= -lreadline
 	}
@@ -173,6 +175,8 @@ SOURCES += \
 	src/cgalauxiliarybuilder.cpp \
 	src/cgaldiscretemodifier.cpp \
 	src/cgalgroupmodifier.cpp \
+	src/cgalinstancer.cpp \
+	src/cgalrepair.cpp \
 	src/cgalsanitizer.cpp \
 	src/codedocdeclaration.cpp \
 	src/export.cpp \
@@ -437,7 +441,22 @@ SOURCES += \
 	src/module/pointsmodule.cpp \
 	src/cgalprojection.cpp \
 	src/function/cbrtfunction.cpp \
-	src/ui/searchwidget.cpp
+	src/ui/searchwidget.cpp \
+	src/batch.cpp \
+	src/scriptcache.cpp \
+	src/server.cpp \
+	src/subtreecache.cpp \
+	src/sweep.cpp \
+	src/evaluationsettings.cpp \
+	src/evaluationprogress.cpp \
+	src/previewevaluator.cpp \
+	src/previewmesh.cpp \
+	src/previewrenderer.cpp \
+	src/displaylist.cpp \
+	src/unitcircle.cpp \
+	src/importcache.cpp \
+	src/zipstreamwriter.cpp \
+	src/cgalpolygonsoup.cpp
 
 HEADERS  += \
 	contrib/fragments.h \
@@ -453,6 +472,8 @@ HEADERS  += \
 	src/cgalauxiliarybuilder.h \
 	src/cgaldiscretemodifier.h \
 	src/cgalgroupmodifier.h \
+	src/cgalinstancer.h \
+	src/cgalrepair.h \
 	src/cgalsanitizer.h \
 	src/cgaltrace.h \
 	src/codedocdeclaration.h \
@@ -737,7 +758,22 @@ HEADERS  += \
 	src/function/isvecfunction.h \
 	src/cgalprojection.h \
 	src/function/cbrtfunction.h \
-	src/ui/searchwidget.h
+	src/ui/searchwidget.h \
+	src/batch.h \
+	src/scriptcache.h \
+	src/server.h \
+	src/subtreecache.h \
+	src/sweep.h \
+	src/evaluationsettings.h \
+	src/evaluationprogress.h \
+	src/previewevaluator.h \
+	src/previewmesh.h \
+	src/previewrenderer.h \
+	src/displaylist.h \
+	src/unitcircle.h \
+	src/importcache.h \
+	src/zipstreamwriter.h \
+	src/cgalpolygonsoup.h
 
 FORMS += \
 	src/ui/commitdialog.ui \
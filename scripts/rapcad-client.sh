@@ -0,0 +1,50 @@
+#!/bin/bash
+# Simple client for the rapcad compile server (rapcad -s NAME)
+# usage: rapcad-client.sh SOCKET INPUT OUTPUT [name=value ...]
+
+if [ $# -lt 3 ]
+then
+ echo "usage: $0 socket input output [name=value ...]" >&2
+ exit 1
+fi
+
+# print the argument as a JSON string
+json_string()
+{
+ local s=$1
+ s=${s//\\/\\\\}
+ s=${s//\"/\\\"}
+ s=${s//$'\n'/\\n}
+ s=${s//$'\r'/\\r}
+ s=${s//$'\t'/\\t}
+ printf '"%s"' "$s"
+}
+
+socket=$1
+input=$(readlink -f "$2")
+output=$3
+format=${output##*.}
+shift 3
+
+params=""
+for p in "$@"
+do
+ name=${p%%=*}
+ value=${p#*=}
+ # numbers are passed as JSON numbers, anything else as a string
+ if [[ $value =~ ^-?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?$ ]]
+ then
+  json=$value
+ else
+  json=$(json_string "$value")
+ fi
+ params="$params${params:+,}$(json_string "$name"):$json"
+done
+
+request="{\"file\":$(json_string "$input"),\"format\":$(json_string "$format"),\"parameters\":{$params}}"
+
+printf '%s\n' "$request" | socat -t 600 - UNIX-CONNECT:"$socket",shut-none | {
+ read -r header
+ echo "$header" >&2
+ cat > "$output"
+}
@@ -17,14 +17,18 @@
  */
 #include "application.h"
 
+#include "batch.h"
 #include "comparer.h"
 #ifdef USE_INTEGTEST
 #include "generator.h"
 #include "tester.h"
 #endif
+#include "importcache.h"
 #include "interactive.h"
 #include "preferences.h"
+#include "server.h"
 #include "stringify.h"
+#include "sweep.h"
 #include "ui/mainwindow.h"
 #include "worker.h"
 #include <QApplication>
@@ -101,10 +105,12 @@ static QStringList getArguments(int argc,char* argv[])
 int Application::run(int argc,char* argv[])
 {
 	strategy=parseArguments(argc,argv);
-	if(strategy)
-		return strategy->evaluate();
+	const int result=strategy?strategy->evaluate():runUserInterface(argc,argv);
 
-	return runUserInterface(argc,argv);
+	/* The cached imports hold CGAL geometry, which can't be left to be
+	 * destroyed along with the other statics */
+	ImportCache::getInstance().flushCaches();
+	return result;
 }
 
 Strategy* Application::parseArguments(int argc,char* argv[])
@@ -131,6 +137,15 @@ Strategy* Application::parseArguments(int argc,char* argv[])
 	const QCommandLineOption outputOption(QStringList() << "o" << "output",QCoreApplication::translate("main","Create output geometry <filename> filename must end with known extension (.stl/.amf/.3mf/...)."),"filename");
 	p.addOption(outputOption);
 
+	const QCommandLineOption batchOption(QStringList() << "b" << "batch",QCoreApplication::translate("main","Compile each pair of input and output filenames listed in manifest <filename>."),"filename");
+	p.addOption(batchOption);
+
+	const QCommandLineOption sweepOption(QStringList() << "w" << "sweep",QCoreApplication::translate("main","Create one output for each row of parameter values in table <filename>."),"filename");
+	p.addOption(sweepOption);
+
+	const QCommandLineOption serverOption(QStringList() << "s" << "server",QCoreApplication::translate("main","Run as a compile server listening on local socket <name>."),"name");
+	p.addOption(serverOption);
+
 	const QCommandLineOption preferenceOption(QStringList() << "p" << "preference",QCoreApplication::translate("main","Set a preference value"),"name-value");
 	p.addOption(preferenceOption);
 
@@ -191,6 +206,21 @@ Strategy* Application::parseArguments(int argc,char* argv[])
 		return new Generator(reporter);
 	}
 #endif
+	if(p.isSet(batchOption)) {
+		auto* b=new Batch(reporter);
+		b->setup(p.value(batchOption));
+		return b;
+	}
+	if(p.isSet(serverOption)) {
+		auto* s=new Server(reporter);
+		s->setup(p.value(serverOption));
+		return s;
+	}
+	if(p.isSet(sweepOption) && p.isSet(outputOption)) {
+		auto* w=new Sweep(reporter);
+		w->setup(inputFile,p.value(sweepOption),p.value(outputOption));
+		return w;
+	}
 	if(p.isSet(outputOption)) {
 		auto* w=new Worker(reporter);
 		w->setup(inputFile,p.value(outputOption),false);
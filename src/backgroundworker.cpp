@@ -52,3 +52,11 @@ void BackgroundWorker::finish()
 {
 	thread->quit();
 }
+
+void BackgroundWorker::preview(Primitive& p)
+{
+	/* Called from the evaluator's threads, the view collects all the
+	 * objects that have finished by the time it gets to them */
+	addPreview(p);
+	emit previewed();
+}
@@ -33,11 +33,13 @@ public:
 	int evaluate() override;
 signals:
 	void done();
+	void previewed();
 protected slots:
 	void start();
 private:
 	void update() override;
 	void finish() override;
+	void preview(Primitive&) override;
 	QThread* thread;
 };
 
@@ -0,0 +1,133 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batch.h"
+#include "builtincreator.h"
+#include "cachemanager.h"
+#include "preferences.h"
+#include "worker.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QProcess>
+#include <QtConcurrent>
+#include <contrib/qtcompat.h>
+
+Batch::Batch(Reporter& r) : Strategy(r)
+{
+}
+
+void Batch::setup(const QString& m)
+{
+	manifestFile=m;
+}
+
+bool Batch::readManifest()
+{
+	QFile f(manifestFile);
+	if(!f.open(QFile::ReadOnly|QFile::Text)) {
+		reporter.reportFileMissingError(manifestFile);
+		return false;
+	}
+
+	/* Each line of the manifest contains an input script and the file to
+	 * export its result to, names containing spaces can be quoted. */
+	const QDir location=QFileInfo(manifestFile).absoluteDir();
+	QTextStream in(&f);
+	int line=0;
+	while(!in.atEnd()) {
+		const QString& text=in.readLine().trimmed();
+		++line;
+		if(text.isEmpty()||text.startsWith('#'))
+			continue;
+
+		const QStringList& args=QProcess::splitCommand(text);
+		if(args.size()!=2) {
+			reporter.reportWarning(tr("manifest line %1 should contain an input and an output filename").arg(line));
+			continue;
+		}
+
+		Job j;
+		j.inputFile=location.absoluteFilePath(args.at(0));
+		j.outputFile=location.absoluteFilePath(args.at(1));
+		j.returnCode=EXIT_FAILURE;
+		j.elapsed=0;
+		jobs.append(j);
+	}
+	return true;
+}
+
+void Batch::compile(Job& j)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	QTextStream out(&j.messages);
+	Reporter r(out);
+	/* Jobs run on the pool's threads, the shared reporter of the builtins
+	 * must pass the reports of this job on to its own reporter */
+	const Reporter::Scope reports(r);
+	Worker w(r);
+	w.setup(j.inputFile,j.outputFile,false);
+	j.returnCode=w.evaluate();
+	out.flush();
+
+	j.elapsed=timer.elapsed();
+}
+
+int Batch::evaluate()
+{
+	reporter.startTiming();
+
+	if(!readManifest())
+		return EXIT_FAILURE;
+
+	/* The builtins are shared by all the jobs, each worker passes their
+	 * reports on to the reporter of its own job */
+	BuiltinCreator::getInstance(reporter);
+
+	/* Geometry cached by one job is shared with all the others */
+	auto& p=Preferences::getInstance();
+	if(p.getCacheEnabled()) {
+		auto& cm=CacheManager::getInstance();
+		cm.enableCaches();
+	}
+
+	/* Each job evaluates on the global pool itself, so run the jobs on
+	 * their own pool where they can't take all of its threads */
+	QThreadPool pool;
+	QList<QFuture<void>> running;
+	for(auto& j: jobs)
+		running.append(QtConcurrent::run(&pool,[&j]() { compile(j); }));
+	for(auto& f: running)
+		f.waitForFinished();
+
+	int failed=0;
+	for(const auto& j: std::as_const(jobs)) {
+		reporter.reportMessages(j.messages);
+		const bool ok=(j.returnCode==EXIT_SUCCESS);
+		if(!ok) ++failed;
+		reporter.reportMessage(tr("%1 -> %2: %3 (%4ms)").arg(j.inputFile,j.outputFile,
+			ok?tr("succeeded"):tr("failed")).arg(j.elapsed));
+	}
+
+	reporter.reportMessage(tr("Compiled: %1 Failed: %2").arg(jobs.size()).arg(failed));
+	reporter.reportTiming(tr("batch"));
+	reporter.setReturnCode(failed?EXIT_FAILURE:EXIT_SUCCESS);
+	return reporter.getReturnCode();
+}
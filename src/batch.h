@@ -0,0 +1,50 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "strategy.h"
+#include <QList>
+#include <QString>
+
+class Batch : public Strategy
+{
+	Q_DECLARE_TR_FUNCTIONS(Batch)
+	Q_DISABLE_COPY_MOVE(Batch)
+public:
+	explicit Batch(Reporter&);
+	~Batch() override = default;
+	void setup(const QString&);
+	int evaluate() override;
+private:
+	struct Job {
+		QString inputFile;
+		QString outputFile;
+		QString messages;
+		int returnCode;
+		qint64 elapsed;
+	};
+	bool readManifest();
+	static void compile(Job&);
+
+	QString manifestFile;
+	QList<Job> jobs;
+};
+
+#endif // BATCH_H
@@ -133,6 +133,9 @@
 
 BuiltinCreator::BuiltinCreator(Reporter& r)
 {
+	/* The builtins outlive the reporter of any one evaluation */
+	r.setShared(true);
+
 	builtins.append(new AbsFunction());
 	builtins.append(new AcosFunction());
 	builtins.append(new AngFunction());
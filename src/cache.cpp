@@ -17,6 +17,7 @@
  */
 
 #include "cache.h"
+#include <QMutexLocker>
 
 Cache::Cache() :
 	index(0)
@@ -77,6 +78,7 @@ Cache::i_Primitive Cache::hashPrimitive(Primitive* pr)
 Primitive* Cache::fetch(Primitive* pr)
 {
 	if(pr) {
+		const QMutexLocker locker(&mutex);
 		const i_Primitive& ip=hashPrimitive(pr);
 		Primitive* np=allPrimitives.value(ip,nullptr);
 		if(np) {
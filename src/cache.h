@@ -22,6 +22,7 @@
 #include "primitive.h"
 #include <QHash>
 #include <QMap>
+#include <QMutex>
 #include <QVector>
 #include <QtGlobal>
 
@@ -47,6 +48,7 @@ private:
 	int index;
 	QMap<decimal,int> map;
 	QHash<i_Primitive,Primitive*> allPrimitives;
+	QMutex mutex;
 };
 
 #if QT_VERSION < 0x050600
@@ -19,6 +19,7 @@
 #include "cachemanager.h"
 #include "cgalcache.h"
 #include "emptycache.h"
+#include "importcache.h"
 
 CacheManager::CacheManager() :
 	cache(new EmptyCache),
@@ -46,18 +47,21 @@ void CacheManager::flushCaches()
 {
 	delete cache;
 	cache=createCache();
+	ImportCache::getInstance().flushCaches();
 }
 
 void CacheManager::disableCaches()
 {
 	disabled=true;
 	flushCaches();
+	ImportCache::getInstance().disableCaches();
 }
 
 void CacheManager::enableCaches()
 {
 	disabled=false;
 	flushCaches();
+	ImportCache::getInstance().enableCaches();
 }
 
 Cache* CacheManager::createCache() const
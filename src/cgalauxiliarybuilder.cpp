@@ -198,8 +198,11 @@ Primitive* CGALAuxiliaryBuilder::buildVolumesPrimitive(Primitive* pr,bool calcMa
 	const QString vs=v.getSizeString();
 	reporter.reportMessage(tr("Volume: %1").arg(vs));
 
-	if(calcMass)
+	if(calcMass) {
 		reporter.reportMessage(tr("Center of Mass: %1").arg(v.getCenterString()));
+		reporter.reportMessage(tr("Surface Area: %1").arg(v.getAreaString()));
+		reporter.reportMessage(tr("Inertia: %1").arg(v.getInertiaString()));
+	}
 
 	const CGAL::Cuboid3& b=v.getBounds();
 	const CGAL::Scalar& x=b.xmax()+((b.xmax()-b.xmin())/10.0);
@@ -30,6 +30,7 @@
 #include <CGAL/Triangulation_face_base_with_info_2.h>
 #include <CGAL/Triangulation_vertex_base_with_info_2.h>
 #include <QList>
+#include <vector>
 
 namespace CGAL
 {
@@ -50,21 +51,25 @@ bool CGALBuilder::getComplete() const
 void CGALBuilder::operator()(CGAL::HalfedgeDS& hds)
 {
 	CGAL::Polyhedron_incremental_builder_3<CGAL::HalfedgeDS> builder(hds,false);
-	const QList<CGAL::Point3> points=primitive.getPoints();
-	const QList<CGALPolygon*> polygons=primitive.getCGALPolygons();
-
-	builder.begin_surface(points.size(),polygons.size());
-
-	for(const auto& p: points)
-		builder.add_vertex(p);
+	const QList<CGALPolygon*>& polygons=primitive.getCGALPolygons();
+	{
+		const QList<CGAL::Point3> points=primitive.getPoints();
+		builder.begin_surface(points.size(),polygons.size());
+		for(const auto& p: points)
+			builder.add_vertex(p);
+	}
 
 	const bool sanitized=primitive.getSanitized();
 	if(sanitized) {
 		//Simple case polyhedron is well formed
+		/* Nothing can be rolled back here, so each part of the staging
+		 * is freed as soon as the builder holds its own copy of it */
+		primitive.clearPoints();
 		for(CGALPolygon* pg: polygons) {
 			const auto& indexes=pg->getIndexes();
 			builder.add_facet(indexes.begin(),indexes.end());
 		}
+		primitive.clearPolygons();
 
 		builder.end_surface();
 		complete=true;
@@ -73,7 +78,8 @@ void CGALBuilder::operator()(CGAL::HalfedgeDS& hds)
 
 
 	for(CGALPolygon* pg: polygons) {
-		auto indexes=pg->getIndexes();
+		const auto& view=pg->getIndexes();
+		std::vector<Polygon::size_type> indexes(view.begin(),view.end());
 		const auto& begin=indexes.begin();
 		const auto& end=std::unique(begin,indexes.end());
 		if(!builder.test_facet(begin,end)) {
@@ -19,9 +19,6 @@
 #include "cgalexplorer.h"
 
 #include "onceonly.h"
-#include <CGAL/Triangulation_3.h>
-#include <CGAL/bounding_box.h>
-#include <CGAL/centroid.h>
 #include <CGAL/config.h>
 #include <QHash>
 
@@ -54,7 +51,7 @@ public:
 	void explore();
 	void evaluate();
 
-	void visit(VertexHandle);
+	void visit(VertexHandle) {}
 	void visit(HalfEdgeHandle) {}
 	void visit(HalfFacetHandle);
 	void visit(SHalfEdgeHandle);
@@ -63,7 +60,6 @@ public:
 
 	QList<CGALPolygon*> getBase();
 	CGALPrimitive* getPrimitive() const;
-	CGALVolume getVolume(bool) const;
 
 private:
 	static HalfEdgeHandle findNewEdge(const QList<HalfEdgeHandle>&,const QList<HalfEdgeHandle>&);
@@ -73,11 +69,8 @@ private:
 	bool direction;
 	const CGAL::NefPolyhedron3& nefPolyhedron;
 	CGALPrimitive* primitive;
-	QList<CGAL::Point3> points;
 	QHash<HalfEdgeHandle,int> perimeterMap;
 	QList<CGALPolygon*> basePolygons;
-	using Points = QList<CGAL::Point3>;
-	QList<Points> volumePoints;
 };
 
 ShellExplorer::ShellExplorer(const CGAL::NefPolyhedron3& n) :
@@ -166,12 +159,8 @@ void ShellExplorer::explore()
 			 * volume. Sometimes a facet will belong to the outer volume with
 			 * the normals reversed so, flip the direction of all the facets
 			 * in subsequent volumes. */
-		if(first_v()) {
+		if(first_v())
 			direction=false;
-		} else {
-			volumePoints.append(points);
-		}
-		points.clear();
 	}
 }
 
@@ -185,11 +174,6 @@ void ShellExplorer::evaluate()
 	}
 }
 
-void ShellExplorer::visit(ShellExplorer::VertexHandle v)
-{
-	points.append(v->point());
-}
-
 void ShellExplorer::visit(ShellExplorer::HalfFacetHandle f)
 {
 	const bool facet = !f->is_twin();
@@ -236,39 +220,6 @@ CGALPrimitive* ShellExplorer::getPrimitive() const
 	return primitive;
 }
 
-CGALVolume ShellExplorer::getVolume(bool calcMass) const
-{
-	using Triangulation = CGAL::Triangulation_3<CGAL::Kernel3>;
-	using CellIterator = Triangulation::Finite_cells_iterator;
-	using CellHandle = Triangulation::Cell_handle;
-	using Tetrahedron = Triangulation::Tetrahedron;
-
-	CGAL::Scalar total=0.0;
-	QList<Tetrahedron> volumes;
-	QList<CGAL::Point3> allPoints;
-	for(const auto& pts: volumePoints) {
-		const Triangulation tr(pts.begin(),pts.end());
-		CellIterator ci;
-		for(ci=tr.finite_cells_begin(); ci!=tr.finite_cells_end(); ++ci) {
-			const Tetrahedron& t=tr.tetrahedron(static_cast<CellHandle>(ci));
-			volumes.append(t);
-			total+=t.volume();
-		}
-		allPoints.append(pts);
-	}
-
-	const CGAL::Cuboid3& b=CGAL::bounding_box(allPoints.begin(),allPoints.end());
-	if(calcMass) {
-		const CGAL::Point3& cm=CGAL::centroid(volumes.begin(),volumes.end());
-		return CGALVolume(b,total,cm);
-	}
-
-	const CGAL::Scalar& cx=(b.xmin()+b.xmax())/2.0;
-	const CGAL::Scalar& cy=(b.ymin()+b.ymax())/2.0;
-	const CGAL::Scalar& cz=(b.zmin()+b.zmax())/2.0;
-	return CGALVolume(b,total,CGAL::Point3(cx,cy,cz));
-}
-
 HalfEdgeHandle ShellExplorer::findNewEdge(const QList<HalfEdgeHandle>& visited, const QList<HalfEdgeHandle>& edges)
 {
 	for(HalfEdgeHandle h: edges)
@@ -339,12 +290,4 @@ QList<CGALPolygon*> CGALExplorer::getBase()
 
 	return explorer->getBase();
 }
-
-CGALVolume CGALExplorer::getVolume(bool calcMass)
-{
-	if(!explore())
-		return CGALVolume();
-
-	return explorer->getVolume(calcMass);
-}
 #endif
@@ -31,7 +31,6 @@ public:
 	~CGALExplorer();
 	CGALPrimitive* getPrimitive();
 	QList<CGALPolygon*> getBase();
-	CGALVolume getVolume(bool);
 private:
 	bool explore();
 	bool evaluate();
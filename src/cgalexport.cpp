@@ -22,6 +22,7 @@
 #include "cgalexplorer.h"
 #include "onceonly.h"
 #include "preferences.h"
+#include "zipstreamwriter.h"
 #include <CGAL/IO/Nef_polyhedron_iostream_3.h>
 #include <CGAL/IO/Polyhedron_VRML_2_ostream.h>
 #include <CGAL/IO/Polyhedron_iostream.h>
@@ -37,9 +38,12 @@
 #endif
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
+#include <QLocale>
+#include <QPair>
 #include <QString>
+#include <QStringList>
 #include <QTextStream>
-#include <contrib/qzipwriter_p.h>
 #include <fstream>
 
 CGALExport::CGALExport(const QFileInfo& f,Primitive* p,Reporter& r) :
@@ -138,6 +142,60 @@ static void generateTriangles(CGAL::Polyhedron3* poly,Generator g)
 	}
 }
 
+/* Most coordinates are exactly a double, those are written in the
+ * shortest form that reads back as the same double, which is much
+ * cheaper than expanding the exact value. Anything else is written
+ * through to_string. Neither uses an exponent, which the importers
+ * do not read */
+static QString to_coordinate_string(const CGAL::Scalar& v)
+{
+	const auto& i=CGAL::to_interval(v);
+	if(i.first==i.second)
+		return QString::number(i.first,'f',QLocale::FloatingPointShortest);
+	return to_string(v);
+}
+
+/* The 3MF matrix multiplies row vectors, so it is the transpose of the
+ * linear part followed by the translation */
+static QString to_transform_string(const CGAL::AffTransformation3& t)
+{
+	QStringList values;
+	for(auto j=0; j<4; ++j)
+		for(auto i=0; i<3; ++i)
+			values.append(to_coordinate_string(t.m(i,j)));
+	return values.join(' ');
+}
+
+/* Vertices are indexed by their handle rather than by comparing their
+ * exact coordinates */
+using VertexIndexes = QHash<const void*,int>;
+
+template<typename Generator>
+static VertexIndexes generateVertices(CGAL::Polyhedron3* poly,Generator g)
+{
+	VertexIndexes indexes;
+	indexes.reserve(static_cast<int>(poly->size_of_vertices()));
+	int i=0;
+	for(VertexIterator vi=poly->vertices_begin(); vi!=poly->vertices_end(); ++vi) {
+		indexes.insert(&*vi,i++);
+		g(vi->point());
+	}
+	return indexes;
+}
+
+template<typename Generator>
+static void generateIndexedTriangles(CGAL::Polyhedron3* poly,const VertexIndexes& indexes,Generator g)
+{
+	for(FacetIterator fi=poly->facets_begin(); fi!=poly->facets_end(); ++fi) {
+		HalffacetCirculator hc=fi->facet_begin();
+		CGAL_assertion(circulator_size(hc)==3);
+		const int v1=indexes.value(&*(hc++)->vertex());
+		const int v2=indexes.value(&*(hc++)->vertex());
+		const int v3=indexes.value(&*(hc++)->vertex());
+		g(v1,v2,v3);
+	}
+}
+
 void CGALExport::exportAsciiSTL() const
 {
 	auto* pr=transformPrimitive();
@@ -199,13 +257,14 @@ void CGALExport::exportAsciiSTL() const
 
 void CGALExport::exportAMF() const
 {
-	auto* file=new QFile(fileInfo.absoluteFilePath());
-	if(!file->open(QIODevice::WriteOnly)) {
+	QFile file(fileInfo.absoluteFilePath());
+	if(!file.open(QIODevice::WriteOnly)) {
 		reporter.reportWarning(tr("Can't write file '%1'").arg(fileInfo.absoluteFilePath()));
 		return;
 	}
 
-	QXmlStreamWriter xml(file);
+	/* The document is written straight to the file as it is generated */
+	QXmlStreamWriter xml(&file);
 	xml.setAutoFormatting(true);
 	xml.writeStartDocument();
 	xml.writeComment("Exported by RapCAD");
@@ -216,8 +275,8 @@ void CGALExport::exportAMF() const
 	descendChildren(primitive,xml);
 
 	xml.writeEndDocument();
-	delete file;
-
+	if(xml.hasError())
+		reporter.reportWarning(tr("Can't write file '%1'").arg(fileInfo.absoluteFilePath()));
 }
 
 void CGALExport::descendChildren(Primitive* p,QXmlStreamWriter& xml) const
@@ -241,32 +300,21 @@ void CGALExport::exportAMFObject(CGALPrimitive* p,QXmlStreamWriter& xml) const
 	xml.writeStartElement("mesh");
 	xml.writeStartElement("vertices");
 
-	int vertexCount=0;
-	QMap<CGAL::Point3,int> vertices;
-	for(VertexIterator vi=poly->vertices_begin(); vi!=poly->vertices_end(); ++vi) {
-		const CGAL::Point3& pt=vi->point();
+	const auto& indexes=generateVertices(poly,[&xml](const auto& pt) {
 		xml.writeStartElement("vertex");
 		xml.writeStartElement("coordinates");
-		const QString& x=to_string(pt.x());
-		const QString& y=to_string(pt.y());
-		const QString& z=to_string(pt.z());
-		xml.writeTextElement("x",x);
-		xml.writeTextElement("y",y);
-		xml.writeTextElement("z",z);
+		xml.writeTextElement("x",to_coordinate_string(pt.x()));
+		xml.writeTextElement("y",to_coordinate_string(pt.y()));
+		xml.writeTextElement("z",to_coordinate_string(pt.z()));
 		xml.writeEndElement(); //coordinates
 		xml.writeEndElement(); //vertex
-
-		vertices.insert(pt,vertexCount++);
-	}
+	});
 
 	xml.writeEndElement(); //vertices
 
 	xml.writeStartElement("volume");
-	generateTriangles(poly,[&xml,&vertices](const auto& t) {
+	generateIndexedTriangles(poly,indexes,[&xml](int v1,int v2,int v3) {
 		xml.writeStartElement("triangle");
-		const int v1=vertices[t[0]];
-		const int v2=vertices[t[1]];
-		const int v3=vertices[t[2]];
 		xml.writeTextElement("v1",QString().setNum(v1));
 		xml.writeTextElement("v2",QString().setNum(v2));
 		xml.writeTextElement("v3",QString().setNum(v3));
@@ -331,10 +379,38 @@ void CGALExport::export3MF() const
 	if(!pr)
 		return;
 
-	CGAL::Polyhedron3* poly=pr->getPolyhedron();
+	/* Geometry that is shared by instances is written once as an object
+	 * and placed by a build item for each of them */
+	QList<CGAL::Polyhedron3*> objects;
+	QList<QPair<int,QString>> items;
+	const auto& instances=pr->getInstances();
+	if(instances.isEmpty()) {
+		objects.append(pr->getPolyhedron());
+		items.append({1,QString()});
+	} else {
+		QHash<const CGALPrimitive::InstanceBase*,int> ids;
+		for(const auto& i: instances) {
+			const CGALPrimitive::InstanceBase* base=i.base.data();
+			if(!ids.contains(base)) {
+				CGALPrimitive shared(base->nefPolyhedron);
+				objects.append(shared.getPolyhedron());
+				ids.insert(base,objects.size());
+			}
+			items.append({ids.value(base),to_transform_string(i.transform)});
+		}
+	}
 
-	QByteArray model;
-	QXmlStreamWriter xml(&model);
+	/* The model is deflated into the archive as it is written, so neither
+	 * the document nor its compressed form is held in memory */
+	ZipStreamWriter zip(fileInfo.absoluteFilePath());
+	if(!zip.open(QIODevice::WriteOnly)) {
+		reporter.reportWarning(tr("Can't write file '%1'").arg(fileInfo.absoluteFilePath()));
+		qDeleteAll(objects);
+		return;
+	}
+
+	zip.beginEntry("3D/3dmodel.model");
+	QXmlStreamWriter xml(&zip);
 	xml.setAutoFormatting(true);
 	xml.writeStartDocument();
 	xml.writeComment("Exported by RapCAD");
@@ -342,57 +418,56 @@ void CGALExport::export3MF() const
 	xml.writeStartElement("model");
 	xml.writeAttribute("unit","millimeter");
 	xml.writeStartElement("resources");
-	xml.writeStartElement("object");
-	xml.writeAttribute("id","1");
-	xml.writeAttribute("type","model");
-	xml.writeStartElement("mesh");
-	xml.writeStartElement("vertices");
-
-	int vertexCount=0;
-	QMap<CGAL::Point3,int> vertices;
-	for(VertexIterator vi=poly->vertices_begin(); vi!=poly->vertices_end(); ++vi) {
-		const CGAL::Point3& p = vi->point();
-		xml.writeStartElement("vertex");
-		const QString& x=to_string(p.x());
-		const QString& y=to_string(p.y());
-		const QString& z=to_string(p.z());
-		xml.writeAttribute("x",x);
-		xml.writeAttribute("y",y);
-		xml.writeAttribute("z",z);
-		xml.writeEndElement(); //vertex
-
-		vertices.insert(p,vertexCount++);
+	for(auto id=1; id<=objects.size(); ++id) {
+		CGAL::Polyhedron3* poly=objects.at(id-1);
+		xml.writeStartElement("object");
+		xml.writeAttribute("id",QString().setNum(id));
+		xml.writeAttribute("type","model");
+		xml.writeStartElement("mesh");
+		xml.writeStartElement("vertices");
+
+		const auto& indexes=generateVertices(poly,[&xml](const auto& p) {
+			xml.writeStartElement("vertex");
+			xml.writeAttribute("x",to_coordinate_string(p.x()));
+			xml.writeAttribute("y",to_coordinate_string(p.y()));
+			xml.writeAttribute("z",to_coordinate_string(p.z()));
+			xml.writeEndElement(); //vertex
+		});
+
+		xml.writeEndElement(); //vertices
+
+		xml.writeStartElement("triangles");
+		generateIndexedTriangles(poly,indexes,[&xml](int v1,int v2,int v3) {
+			xml.writeStartElement("triangle");
+			xml.writeAttribute("v1",QString().setNum(v1));
+			xml.writeAttribute("v2",QString().setNum(v2));
+			xml.writeAttribute("v3",QString().setNum(v3));
+			xml.writeEndElement(); //triangle
+		});
+		xml.writeEndElement(); //triangles
+		xml.writeEndElement(); //mesh
+		xml.writeEndElement(); //object
 	}
-
-	xml.writeEndElement(); //vertices
-
-	xml.writeStartElement("triangles");
-	generateTriangles(poly,[&xml,&vertices](const auto& t) {
-		xml.writeStartElement("triangle");
-		const int v1=vertices[t[0]];
-		const int v2=vertices[t[1]];
-		const int v3=vertices[t[2]];
-		xml.writeAttribute("v1",QString().setNum(v1));
-		xml.writeAttribute("v2",QString().setNum(v2));
-		xml.writeAttribute("v3",QString().setNum(v3));
-		xml.writeEndElement(); //triangle
-	});
-	xml.writeEndElement(); //triangles
-	xml.writeEndElement(); //mesh
-	xml.writeEndElement(); //object
 	xml.writeEndElement(); //resources
 
 	xml.writeStartElement("build");
-	xml.writeStartElement("item");
-	xml.writeAttribute("objectid","1");
-	xml.writeEndElement(); //item
+	for(const auto& item: items) {
+		xml.writeStartElement("item");
+		xml.writeAttribute("objectid",QString().setNum(item.first));
+		if(!item.second.isEmpty())
+			xml.writeAttribute("transform",item.second);
+		xml.writeEndElement(); //item
+	}
 	xml.writeEndElement(); //build
 
 	xml.writeEndElement(); //model
 	xml.writeEndDocument();
+	qDeleteAll(objects);
+	if(xml.hasError())
+		reporter.reportWarning(tr("Can't write file '%1'").arg(fileInfo.absoluteFilePath()));
 
-	QByteArray rels;
-	QXmlStreamWriter relxml(&rels);
+	zip.beginEntry("_rels/.rels");
+	QXmlStreamWriter relxml(&zip);
 	relxml.writeDefaultNamespace("http://schemas.openxmlformats.org/package/2006/relationships");
 	relxml.writeStartDocument();
 	relxml.writeStartElement("Relationships");
@@ -404,8 +479,8 @@ void CGALExport::export3MF() const
 	relxml.writeEndElement(); //Relationships
 	relxml.writeEndDocument();
 
-	QByteArray ctype;
-	QXmlStreamWriter cxml(&ctype);
+	zip.beginEntry("[Content_Types].xml");
+	QXmlStreamWriter cxml(&zip);
 	cxml.writeStartDocument();
 	cxml.writeDefaultNamespace("http://schemas.openxmlformats.org/package/2006/content-types");
 	cxml.writeStartElement("Types");
@@ -419,13 +494,7 @@ void CGALExport::export3MF() const
 	cxml.writeEndElement(); //Default
 	cxml.writeEndElement(); //Types
 	cxml.writeEndDocument();
-
-	QZipWriter zipwriter(fileInfo.absoluteFilePath());
-	zipwriter.addFile("3D/3dmodel.model",model);
-	zipwriter.addFile("_rels/.rels",rels);
-	zipwriter.addFile("[Content_Types].xml",ctype);
-	zipwriter.close();
-	delete poly;
+	zip.close();
 }
 
 void CGALExport::exportNEF() const
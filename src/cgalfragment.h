@@ -28,7 +28,8 @@ class CGALFragment : public Fragment
 {
 public:
 	explicit CGALFragment(const Context&);
-	int getFragments(const CGAL::Scalar&) const override;
+protected:
+	int calculateFragments(const CGAL::Scalar&) const override;
 };
 
 #endif // CGALFRAGMENT_H
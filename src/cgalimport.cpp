@@ -19,6 +19,7 @@
 #include "cgalimport.h"
 
 #include "cgalprimitive.h"
+#include "importcache.h"
 #include "nodeevaluator.h"
 #include "script.h"
 #include "treeevaluator.h"
@@ -32,14 +33,19 @@
 #include <CGAL/IO/OBJ_reader.h>
 #endif
 #include <CGAL/IO/Polyhedron_iostream.h>
+#include <QHash>
+#include <QPair>
 #include <QRegularExpression>
+#include <QScopedPointer>
 #include <QStringList>
+#include <QTextStream>
 #include <QXmlStreamReader>
 #include <fstream>
 
-CGALImport::CGALImport(const QFileInfo& f,Reporter& r) :
+CGALImport::CGALImport(const QFileInfo& f,Reporter& r,bool h) :
 	fileInfo(f),
-	reporter(r)
+	reporter(r),
+	fillHoles(h)
 {
 }
 
@@ -93,16 +99,38 @@ Primitive* CGALImport::importNEF() const
 
 Primitive* CGALImport::importOBJ() const
 {
-	auto* cp=new CGALPrimitive();
-	cp->setSanitized(false);
-	std::vector<CGAL::Point3> points;
-	std::vector<std::vector<std::size_t> > faces;
+	CGALRepair::Points points;
+	CGALRepair::Polygons faces;
 	std::ifstream file(fileInfo.absoluteFilePath().toStdString());
 #if CGAL_VERSION_NR >= CGAL_VERSION_NUMBER(5,3,0)
 	CGAL::IO::read_OBJ(file,points,faces);
 #else
 	CGAL::read_OBJ(file,points,faces);
 #endif
+	return importSoup(points,faces);
+}
+
+Primitive* CGALImport::importSoup(const CGALRepair::Points& points,const CGALRepair::Polygons& faces) const
+{
+	/* Repair the soup as it is imported so that a broken mesh can still
+	 * go straight to a Nef polyhedron rather than a union of facets */
+	CGAL::Polyhedron3 poly;
+	CGALRepair r(points,faces);
+	r.setFillHoles(fillHoles);
+	if(r.repair(poly)) {
+		if(r.hasRepairs())
+			reporter.reportMessage(r.getSummary());
+		return new CGALPrimitive(poly);
+	}
+
+	/* The repair worked on a copy so the soup is still as it was read */
+	if(fillHoles)
+		reporter.reportWarning(tr("could not repair '%1' into a closed mesh").arg(fileInfo.fileName()));
+	else
+		reporter.reportMessage(tr("'%1' is not a closed mesh, it is imported as it is").arg(fileInfo.fileName()));
+
+	auto* cp=new CGALPrimitive();
+	cp->setSanitized(false);
 	for(const auto& pt : points)
 		cp->createVertex(pt);
 
@@ -117,21 +145,11 @@ Primitive* CGALImport::importOBJ() const
 Primitive* CGALImport::importSTL() const
 {
 #if CGAL_VERSION_NR >= CGAL_VERSION_NUMBER(5,3,0)
-	auto* cp=new CGALPrimitive();
-	cp->setSanitized(false);
-	std::vector<CGAL::Point3> points;
-	std::vector<std::vector<std::size_t> > faces;
+	CGALRepair::Points points;
+	CGALRepair::Polygons faces;
 	std::ifstream file(fileInfo.absoluteFilePath().toStdString());
 	CGAL::IO::read_STL(file,points,faces);
-	for(const auto& pt : points)
-		cp->createVertex(pt);
-
-	for(const auto& f : faces) {
-		CGALPolygon& pg=cp->createPolygon();
-		for(const auto& i : f)
-			pg.append(static_cast<Polygon::size_type>(i));
-	}
-	return cp;
+	return importSoup(points,faces);
 #else
 	auto* p=new CGALPrimitive();
 	p->setSanitized(false);
@@ -299,104 +317,226 @@ Primitive* CGALImport::importAMF() const
 	return p;
 }
 
+/* A 3MF object holds either its own mesh, whose vertex indexes start at
+ * zero, or components that place other objects */
+class ThreeMFObject
+{
+public:
+	QList<CGAL::Point3> vertices;
+	QList<QList<int>> triangles;
+	QList<QPair<QString,CGAL::AffTransformation3>> components;
+};
+
+/* The 3MF matrix multiplies row vectors, the rows of the linear part are
+ * followed by the translation */
+static CGAL::AffTransformation3 to_transform(const QString& s)
+{
+	const QStringList& values=s.simplified().split(' ');
+	if(values.size()!=12)
+		return CGAL::AffTransformation3(CGAL::IDENTITY);
+
+	QList<CGAL::Scalar> m;
+	for(const auto& v: values)
+		m.append(to_decimal(v));
+	return CGAL::AffTransformation3(
+		m.at(0),m.at(3),m.at(6),m.at(9),
+		m.at(1),m.at(4),m.at(7),m.at(10),
+		m.at(2),m.at(5),m.at(8),m.at(11));
+}
+
+static QPair<QString,CGAL::AffTransformation3> readPlacement(QXmlStreamReader& xml)
+{
+	const auto attributes=xml.attributes();
+	return {attributes.value("objectid").toString(),
+		to_transform(attributes.value("transform").toString())};
+}
+
+static void readMesh(QXmlStreamReader& xml,ThreeMFObject& o)
+{
+	while(xml.readNextStartElement()) {
+		if(xml.name()==QString("vertices")) {
+			while(xml.readNextStartElement()) {
+				if(xml.name()==QString("vertex")) {
+					const auto attributes=xml.attributes();
+					const CGAL::Scalar& x=to_decimal(attributes.value("x").toString());
+					const CGAL::Scalar& y=to_decimal(attributes.value("y").toString());
+					const CGAL::Scalar& z=to_decimal(attributes.value("z").toString());
+					o.vertices.append(CGAL::Point3(x,y,z));
+				}
+				xml.skipCurrentElement();
+			}
+		} else if(xml.name()==QString("triangles")) {
+			while(xml.readNextStartElement()) {
+				if(xml.name()==QString("triangle")) {
+					const auto attributes=xml.attributes();
+					o.triangles.append({
+						attributes.value("v1").toInt(),
+						attributes.value("v2").toInt(),
+						attributes.value("v3").toInt()
+					});
+				}
+				xml.skipCurrentElement();
+			}
+		} else {
+			xml.skipCurrentElement();
+		}
+	}
+}
+
+static void readObject(QXmlStreamReader& xml,ThreeMFObject& o)
+{
+	while(xml.readNextStartElement()) {
+		if(xml.name()==QString("mesh")) {
+			readMesh(xml,o);
+		} else if(xml.name()==QString("components")) {
+			while(xml.readNextStartElement()) {
+				if(xml.name()==QString("component"))
+					o.components.append(readPlacement(xml));
+				xml.skipCurrentElement();
+			}
+		} else {
+			xml.skipCurrentElement();
+		}
+	}
+}
+
+/* Append the mesh of an object and of its components placed by the given
+ * transform. The vertex indexes of each mesh are offset by the vertices
+ * that are already in the primitive */
+static void appendObject(CGALPrimitive* p,int& count,const QHash<QString,ThreeMFObject>& objects,
+						 const QString& id,const CGAL::AffTransformation3& t,int depth)
+{
+	const auto it=objects.constFind(id);
+	if(it==objects.constEnd() || depth>objects.size())
+		return;
+
+	const int offset=count;
+	for(const auto& v: it->vertices) {
+		p->createVertex(v.transform(t));
+		++count;
+	}
+	for(const auto& tr: it->triangles) {
+		Polygon& pg=p->createPolygon();
+		for(const auto i: tr)
+			pg.append(offset+i);
+	}
+	for(const auto& c: it->components)
+		appendObject(p,count,objects,c.first,t*c.second,depth+1);
+}
+
 Primitive* CGALImport::import3MF() const
 {
-	auto* p=new CGALPrimitive();
-	p->setSanitized(false);
 	QFile f(fileInfo.absoluteFilePath());
 	if(!f.open(QIODevice::ReadOnly)) {
 		reporter.reportWarning(tr("Can't open import file '%1'").arg(fileInfo.absoluteFilePath()));
+		auto* p=new CGALPrimitive();
+		p->setSanitized(false);
 		return p;
 	}
 	QZipReader zip(fileInfo.absoluteFilePath());
 	const QByteArray& data=zip.fileData("3D/3dmodel.model");
 	zip.close();
+
+	QHash<QString,ThreeMFObject> objects;
+	QStringList order;
+	QList<QPair<QString,CGAL::AffTransformation3>> items;
+	bool build=false;
 	QXmlStreamReader xml(data);
 	if(xml.readNextStartElement() && xml.name()==QString("model")) {
 		while(xml.readNextStartElement()) {
 			if(xml.name()==QString("resources")) {
 				while(xml.readNextStartElement()) {
 					if(xml.name()==QString("object")) {
-						while(xml.readNextStartElement()) {
-							if(xml.name()==QString("mesh")) {
-								while(xml.readNextStartElement()) {
-									if(xml.name()==QString("vertices")) {
-										while(xml.readNextStartElement()) {
-											if(xml.name()==QString("vertex")) {
-												CGAL::Scalar x=0.0;
-												CGAL::Scalar y=0.0;
-												CGAL::Scalar z=0.0;
-												const auto attributes=xml.attributes();
-												for(const auto& attr: attributes) {
-													auto n=attr.name();
-													auto v=attr.value();
-													if(n==QString("x"))
-														x=to_decimal(v.toString());
-													else if(n==QString("y"))
-														y=to_decimal(v.toString());
-													else if(n==QString("z"))
-														z=to_decimal(v.toString());
-												}
-												p->createVertex(x,y,z);
-											}
-											xml.skipCurrentElement();
-										}
-									} else if(xml.name()==QString("triangles")) {
-										while(xml.readNextStartElement()) {
-											if(xml.name()==QString("triangle")) {
-												int v1=0;
-												int v2=0;
-												int v3=0;
-												const auto attributes=xml.attributes();
-												for(const auto& attr: attributes) {
-													auto n=attr.name();
-													auto v=attr.value();
-													if(n == QString("v1"))
-														v1=v.toInt();
-													else if(n == QString("v2"))
-														v2=v.toInt();
-													else if(n == QString("v3"))
-														v3=v.toInt();
-												}
-												Polygon& pg=p->createPolygon();
-												pg.append(v1);
-												pg.append(v2);
-												pg.append(v3);
-											}
-											xml.skipCurrentElement();
-										}
-									} else {
-										xml.skipCurrentElement();
-									}
-								}
-							} else {
-								xml.skipCurrentElement();
-							}
-						}
+						const QString& id=xml.attributes().value("id").toString();
+						order.append(id);
+						readObject(xml,objects[id]);
 					} else {
 						xml.skipCurrentElement();
 					}
 				}
+			} else if(xml.name()==QString("build")) {
+				build=true;
+				while(xml.readNextStartElement()) {
+					if(xml.name()==QString("item"))
+						items.append(readPlacement(xml));
+					xml.skipCurrentElement();
+				}
 			} else {
 				xml.skipCurrentElement();
 			}
 		}
 	}
-	return p;
+
+	/* Without a build every object is placed where it is */
+	if(!build)
+		for(const auto& id: std::as_const(order))
+			items.append({id,CGAL::AffTransformation3(CGAL::IDENTITY)});
+
+	/* Each build item is its own volume, items may overlap so they are
+	 * joined rather than merged into one mesh */
+	Primitive* result=nullptr;
+	for(const auto& item: std::as_const(items)) {
+		auto* p=new CGALPrimitive();
+		p->setSanitized(false);
+		int count=0;
+		appendObject(p,count,objects,item.first,item.second,0);
+		result=result?result->join(p):p;
+	}
+	if(!result) {
+		auto* p=new CGALPrimitive();
+		p->setSanitized(false);
+		return p;
+	}
+	return result;
 }
 
 Primitive* CGALImport::importRCAD() const
 {
-	Script s(reporter);
-	s.parse(fileInfo);
-	TreeEvaluator te(reporter);
-	s.accept(te);
+	/* Sub-assemblies are often imported many times, so reuse the result
+	 * for as long as neither the script nor its imports change */
+	auto& ic=ImportCache::getInstance();
+	Primitive* cached=ic.fetch(fileInfo,reporter);
+	if(cached)
+		return cached;
+
+	/* Collect what the script reports so that it can be replayed when the
+	 * cached result is used */
+	QString output;
+	QString messages;
+	QTextStream outputStream(&output);
+	QTextStream messageStream(&messages);
+	Reporter r(outputStream,messageStream);
+	auto replay=[&]() {
+		outputStream.flush();
+		messageStream.flush();
+		QTextStream& out=reporter.getOutput();
+		out << output;
+		out.flush();
+		reporter.reportMessages(messages);
+	};
 
-	Node* n = te.getRootNode();
-	NodeEvaluator ne(reporter);
-	n->accept(ne);
-	delete n;
+	Primitive* result=nullptr;
+	QStringList dependencies;
+	try {
+		const Reporter::Scope reports(r);
+		Script s(r);
+		s.parse(fileInfo);
+		TreeEvaluator te(r);
+		s.accept(te);
+
+		const QScopedPointer<Node> n(te.getRootNode());
+		dependencies=te.getImportedFiles();
+		ImportCache::collectImports(*n,dependencies);
+		NodeEvaluator ne(r);
+		n->accept(ne);
+		result=ne.getResult();
+	} catch(...) {
+		replay();
+		throw;
+	}
+	replay();
 
-	return ne.getResult();
+	ic.store(fileInfo,dependencies,result,output,messages);
+	return result;
 }
 #endif
@@ -19,6 +19,7 @@
 #ifndef CGALIMPORT_H
 #define CGALIMPORT_H
 
+#include "cgalrepair.h"
 #include "primitive.h"
 #include "reporter.h"
 #include <QFileInfo>
@@ -27,7 +28,7 @@ class CGALImport
 {
 	Q_DECLARE_TR_FUNCTIONS(CGALImport)
 public:
-	explicit CGALImport(const QFileInfo&,Reporter&);
+	explicit CGALImport(const QFileInfo&,Reporter&,bool fillHoles=false);
 	Primitive* import() const;
 private:
 	Primitive* importOFF() const;
@@ -37,9 +38,11 @@ private:
 	Primitive* import3MF() const;
 	Primitive* importAMF() const;
 	Primitive* importNEF() const;
+	Primitive* importSoup(const CGALRepair::Points&,const CGALRepair::Polygons&) const;
 
 	const QFileInfo& fileInfo;
 	Reporter& reporter;
+	bool fillHoles;
 
 };
 
@@ -0,0 +1,111 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef USE_CGAL
+#include "cgalinstancer.h"
+#include <QCryptographicHash>
+#include <QMutexLocker>
+#include <QPromise>
+
+CGALInstancer::CGALInstancer() :
+	keys(ownKeys)
+{
+}
+
+CGALInstancer::CGALInstancer(SubtreeKeys& k) :
+	keys(k)
+{
+}
+
+CGALInstancer::Base CGALInstancer::createBase(Primitive* pr)
+{
+	auto* cp=dynamic_cast<CGALPrimitive*>(pr);
+	if(!cp||!cp->isFullyDimentional())
+		return Base();
+
+	/* Auxiliary children such as datums are transformed along with the
+	 * primitive, so they can't be left behind in the shared geometry */
+	for(Primitive* c: cp->getChildren())
+		if(!dynamic_cast<CGALPrimitive*>(c))
+			return Base();
+
+	return Base(new CGALPrimitive::InstanceBase{cp->getNefPolyhedron(),cp->getBoundingBox()});
+}
+
+Primitive* CGALInstancer::place(const Node& n,const Evaluate& evaluate)
+{
+	/* The keys of the children are calculated once for the whole tree,
+	 * so identifying them costs little even for placements that turn out
+	 * to be used only once */
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	for(Node* c: n.getChildren()) {
+		const QByteArray& k=keys.getKey(*c);
+		if(k.isEmpty())
+			return evaluate();
+		hash.addData(k);
+	}
+	const QByteArray& key=hash.result();
+
+	QPromise<Base> promise;
+	QFuture<Base> future;
+	bool first=false;
+	{
+		const QMutexLocker locker(&mutex);
+		auto it=bases.constFind(key);
+		if(it==bases.constEnd()) {
+			first=true;
+			future=promise.future();
+			bases.insert(key,future);
+		} else {
+			future=it.value();
+		}
+	}
+
+	if(!first) {
+		/* Wait for the thread that got here first to evaluate the
+		 * children, and when they can be shared dispose of the
+		 * primitives which won't be evaluated */
+		const Base& base=future.result();
+		if(!base)
+			return evaluate();
+		SubtreeKeys::dispose(n);
+		return new CGALPrimitive(base);
+	}
+
+	promise.start();
+	Primitive* result=nullptr;
+	Base base;
+	try {
+		result=evaluate();
+		base=createBase(result);
+	} catch(...) {
+		promise.addResult(Base());
+		promise.finish();
+		throw;
+	}
+	promise.addResult(base);
+	promise.finish();
+
+	if(!base)
+		return result;
+
+	delete result;
+	return new CGALPrimitive(base);
+}
+
+#endif
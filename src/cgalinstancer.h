@@ -0,0 +1,67 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef USE_CGAL
+#ifndef CGALINSTANCER_H
+#define CGALINSTANCER_H
+
+#include "cgalprimitive.h"
+#include "node.h"
+#include "subtreecache.h"
+#include <QByteArray>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <functional>
+
+/**
+ * @brief Shares the evaluated children of transformations that place the
+ * same subtree many times, so that each placement only holds a matrix.
+ */
+class CGALInstancer
+{
+	Q_DISABLE_COPY_MOVE(CGALInstancer)
+public:
+	CGALInstancer();
+	/**
+	 * @brief Identify the children by the keys of an evaluator that
+	 * already calculates them for its subtrees.
+	 */
+	explicit CGALInstancer(SubtreeKeys&);
+	using Evaluate=std::function<Primitive*()>;
+	/**
+	 * @brief Evaluate the children of a transformation once and place
+	 * them as an instance of the shared result.
+	 * @param n The innermost node of the transformation.
+	 * @param evaluate Evaluates the union of the children of the node.
+	 * @return A primitive with a single instance, or the result of
+	 * evaluate when the children can't be shared.
+	 */
+	Primitive* place(const Node& n,const Evaluate& evaluate);
+private:
+	using Base=QSharedPointer<const CGALPrimitive::InstanceBase>;
+	static Base createBase(Primitive*);
+	SubtreeKeys ownKeys;
+	SubtreeKeys& keys;
+	QMutex mutex;
+	QHash<QByteArray,QFuture<Base>> bases;
+};
+
+#endif // CGALINSTANCER_H
+#endif
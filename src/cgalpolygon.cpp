@@ -18,20 +18,42 @@
 #ifdef USE_CGAL
 #include "cgalpolygon.h"
 
+#include "cgalpolygonsoup.h"
 #include "cgalprimitive.h"
 #include "onceonly.h"
 #include <CGAL/normal_vector_newell_3.h>
 
-CGALPolygon::CGALPolygon(CGALPrimitive& p) :
+CGALPolygon::CGALPolygon(CGALPrimitive& p,CGALPolygonSoup& s,size_type n) :
 	Polygon(p),
-	projection(nullptr),
+	soup(&s),
+	number(n),
+	projected(false),
 	orientation(CGAL::POSITIVE)
 {
 }
 
 CGALPolygon::~CGALPolygon()
 {
-	delete projection;
+}
+
+void CGALPolygon::append(size_type i)
+{
+	soup->append(number,i);
+}
+
+void CGALPolygon::prepend(size_type i)
+{
+	soup->prepend(number,i);
+}
+
+Polygon::Indexes CGALPolygon::getIndexes() const
+{
+	return soup->getIndexes(number);
+}
+
+void CGALPolygon::setIndexes(const Indexes& value)
+{
+	soup->assign(number,value);
 }
 
 void CGALPolygon::appendVertex(const CGAL::Point3& pt)
@@ -47,9 +69,11 @@ void CGALPolygon::appendVertex(const CGAL::Point3& pt, bool direction)
 
 QList<CGAL::Point3> CGALPolygon::getPoints() const
 {
+	const Indexes& indexes=getIndexes();
 	QList<CGAL::Point3> points;
+	points.reserve(indexes.size());
 	const auto& pr=dynamic_cast<const CGALPrimitive&>(parent);
-	const QList<CGAL::Point3> parentPoints=pr.getPoints();
+	const QList<CGAL::Point3>& parentPoints=pr.getPoints();
 	for(auto i: indexes)
 		points.append(parentPoints.at(i));
 	return points;
@@ -58,10 +82,12 @@ QList<CGAL::Point3> CGALPolygon::getPoints() const
 QList<CGAL::Point2> CGALPolygon::getProjectedPoints()
 {
 	CGALProjection* pro=getProjection();
+	const Indexes& indexes=getIndexes();
 	QList<CGAL::Point2> points;
+	points.reserve(indexes.size());
 	const auto& pr=dynamic_cast<const CGALPrimitive&>(parent);
 	const QList<CGAL::Point3>& parentPoints=pr.getPoints();
-	for(auto i: getIndexes()) {
+	for(auto i: indexes) {
 		const CGAL::Point3& p3=parentPoints.at(i);
 		points.append(pro->project(p3));
 	}
@@ -71,6 +97,7 @@ QList<CGAL::Point2> CGALPolygon::getProjectedPoints()
 QList<CGAL::Segment3> CGALPolygon::getSegments() const
 {
 	QList<CGAL::Segment3> segments;
+	segments.reserve(getIndexes().size());
 	CGAL::Point3 prev;
 	OnceOnly first;
 	for(const auto& next: getPoints()) {
@@ -83,13 +110,14 @@ QList<CGAL::Segment3> CGALPolygon::getSegments() const
 
 CGAL::Vector3 CGALPolygon::getNormal() const
 {
-	return plane.orthogonal_vector();
+	return getPlane().orthogonal_vector();
 }
 
 void CGALPolygon::calculateProjection()
 {
-	const CGAL::Vector3& v=plane.orthogonal_vector();
-	projection=new CGALProjection(v);
+	const CGAL::Vector3& v=soup->getPlane(number).orthogonal_vector();
+	projection=CGALProjection(v);
+	projected=true;
 }
 
 CGAL::Orientation CGALPolygon::getOrientation() const
@@ -102,38 +130,46 @@ void CGALPolygon::setOrientation(const CGAL::Orientation& value)
 	orientation=value;
 }
 
-void CGALPolygon::calculatePlane()
+CGAL::Plane3 CGALPolygon::newellPlane() const
 {
 	QList<CGAL::Point3> points=getPoints();
 #if CGAL_VERSION_NR < CGAL_VERSION_NUMBER(5,3,0)
-	if(points.size()==3) {
-		plane=CGAL::Plane3(points.at(0),points.at(1),points.at(2));
-	} else
+	if(points.size()==3)
+		return CGAL::Plane3(points.at(0),points.at(1),points.at(2));
 #endif
-	{
-		CGAL::Vector3 v;
-		CGAL::normal_vector_newell_3(points.begin(),points.end(),v);
-		plane=CGAL::Plane3(points.first(),v);
-	}
+	CGAL::Vector3 v;
+	CGAL::normal_vector_newell_3(points.begin(),points.end(),v);
+	return CGAL::Plane3(points.first(),v);
+}
+
+void CGALPolygon::calculatePlane()
+{
+	soup->setPlane(number,newellPlane());
 	calculateProjection();
 }
 
 CGAL::Plane3 CGALPolygon::getPlane() const
 {
-	return plane;
+	/* Most polygons never need their plane, so it is only calculated
+	 * the first time that it is asked for */
+	if(!soup->hasPlane(number))
+		soup->setPlane(number,newellPlane());
+	return soup->getPlane(number);
 }
 
 void CGALPolygon::setPlane(const CGAL::Plane3& p)
 {
-	plane=p;
+	soup->setPlane(number,p);
 	calculateProjection();
 }
 
 CGALProjection* CGALPolygon::getProjection()
 {
-	if(!projection)
-		calculatePlane();
-	return projection;
+	if(!projected) {
+		getPlane();
+		calculateProjection();
+	}
+	return &projection;
 }
 
 bool CGALPolygon::sameProjection(CGALPolygon* other)
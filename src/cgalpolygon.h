@@ -34,9 +34,14 @@ class CGALPolygon : public Polygon
 {
 	Q_DISABLE_COPY_MOVE(CGALPolygon)
 public:
-	explicit CGALPolygon(class CGALPrimitive&);
+	CGALPolygon(class CGALPrimitive&,class CGALPolygonSoup&,size_type);
 	~CGALPolygon() override;
 
+	void append(size_type) override;
+	void prepend(size_type) override;
+	Indexes getIndexes() const override;
+	void setIndexes(const Indexes&) override;
+
 	void appendVertex(const CGAL::Point3&);
 	void appendVertex(const CGAL::Point3&,bool);
 
@@ -57,10 +62,14 @@ public:
 	void setOrientation(const CGAL::Orientation&);
 
 private:
+	friend class CGALPolygonSoup;
+	CGAL::Plane3 newellPlane() const;
 	void calculateProjection();
 
-	CGAL::Plane3 plane;
-	CGALProjection* projection;
+	CGALPolygonSoup* soup;
+	size_type number;
+	CGALProjection projection;
+	bool projected;
 	CGAL::Orientation orientation;
 };
 #endif // CGALPOLYGON_H
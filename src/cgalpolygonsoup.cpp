@@ -0,0 +1,195 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef USE_CGAL
+#include "cgalpolygonsoup.h"
+
+CGALPolygonSoup::CGALPolygonSoup(CGALPrimitive& p) :
+	primitive(p),
+	unused(0)
+{
+}
+
+CGALPolygon& CGALPolygonSoup::create()
+{
+	const size_type n=offsets.size();
+	offsets.append(indexes.size());
+	sizes.append(0);
+	planes.append(CGAL::Plane3());
+	calculated.append(false);
+	auto& pg=handles.emplace_back(primitive,*this,n);
+	polygons.append(&pg);
+	return pg;
+}
+
+void CGALPolygonSoup::clear()
+{
+	polygons.clear();
+	handles.clear();
+	indexes.clear();
+	offsets.clear();
+	sizes.clear();
+	planes.clear();
+	calculated.clear();
+	unused=0;
+}
+
+void CGALPolygonSoup::swap(CGALPolygonSoup& other)
+{
+	indexes.swap(other.indexes);
+	offsets.swap(other.offsets);
+	sizes.swap(other.sizes);
+	planes.swap(other.planes);
+	calculated.swap(other.calculated);
+	std::swap(unused,other.unused);
+	handles.swap(other.handles);
+	polygons.swap(other.polygons);
+
+	/* The handles keep their addresses when the deques are swapped but
+	 * they now belong to the other soup */
+	for(auto& pg: handles)
+		pg.soup=this;
+	for(auto& pg: other.handles)
+		pg.soup=&other;
+}
+
+const QList<CGALPolygon*>& CGALPolygonSoup::getPolygons() const
+{
+	return polygons;
+}
+
+CGALPolygonSoup::const_iterator CGALPolygonSoup::begin() const
+{
+	return polygons.constBegin();
+}
+
+CGALPolygonSoup::const_iterator CGALPolygonSoup::end() const
+{
+	return polygons.constEnd();
+}
+
+bool CGALPolygonSoup::isEmpty() const
+{
+	return polygons.isEmpty();
+}
+
+CGALPolygonSoup::size_type CGALPolygonSoup::size() const
+{
+	return polygons.size();
+}
+
+CGALPolygon* CGALPolygonSoup::constLast() const
+{
+	return polygons.constLast();
+}
+
+void CGALPolygonSoup::append(size_type n,size_type i)
+{
+	moveToEnd(n);
+	indexes.append(i);
+	++sizes[n];
+}
+
+void CGALPolygonSoup::prepend(size_type n,size_type i)
+{
+	moveToEnd(n);
+	indexes.insert(offsets.at(n),i);
+	++sizes[n];
+}
+
+void CGALPolygonSoup::assign(size_type n,const Polygon::Indexes& value)
+{
+	/* The value may be a view into this soup */
+	QVector<size_type> copy;
+	copy.reserve(value.size());
+	for(auto i: value)
+		copy.append(i);
+
+	if(atEnd(n))
+		indexes.resize(offsets.at(n));
+	else
+		unused+=sizes.at(n);
+
+	offsets[n]=indexes.size();
+	sizes[n]=copy.size();
+	indexes.append(copy);
+}
+
+Polygon::Indexes CGALPolygonSoup::getIndexes(size_type n) const
+{
+	const size_type* data=indexes.constData()+offsets.at(n);
+	return Polygon::Indexes(data,data+sizes.at(n));
+}
+
+bool CGALPolygonSoup::hasPlane(size_type n) const
+{
+	return calculated.at(n);
+}
+
+const CGAL::Plane3& CGALPolygonSoup::getPlane(size_type n) const
+{
+	return planes.at(n);
+}
+
+void CGALPolygonSoup::setPlane(size_type n,const CGAL::Plane3& p)
+{
+	planes[n]=p;
+	calculated[n]=true;
+}
+
+bool CGALPolygonSoup::atEnd(size_type n) const
+{
+	return offsets.at(n)+sizes.at(n)==indexes.size();
+}
+
+void CGALPolygonSoup::moveToEnd(size_type n)
+{
+	/* Polygons are nearly always built one after the other, so only a
+	 * polygon that is extended after a later one was started has to have
+	 * its indexes copied to the end of the array */
+	if(atEnd(n)) return;
+
+	if(unused>indexes.size()/2) {
+		compact();
+		if(atEnd(n)) return;
+	}
+
+	const size_type offset=offsets.at(n);
+	const size_type count=sizes.at(n);
+	offsets[n]=indexes.size();
+	for(size_type i=0; i<count; ++i) {
+		const size_type index=indexes.at(offset+i);
+		indexes.append(index);
+	}
+	unused+=count;
+}
+
+void CGALPolygonSoup::compact()
+{
+	QVector<size_type> packed;
+	packed.reserve(indexes.size()-unused);
+	for(size_type n=0; n<offsets.size(); ++n) {
+		const size_type offset=offsets.at(n);
+		offsets[n]=packed.size();
+		for(size_type i=0; i<sizes.at(n); ++i)
+			packed.append(indexes.at(offset+i));
+	}
+	indexes.swap(packed);
+	unused=0;
+}
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef USE_CGAL
+#ifndef CGALPOLYGONSOUP_H
+#define CGALPOLYGONSOUP_H
+
+#include "cgal.h"
+
+#include "cgalpolygon.h"
+#include <QList>
+#include <QVector>
+#include <deque>
+
+/**
+ * @brief The polygons of a primitive stored as flat arrays. The indexes of
+ * every polygon live in one array addressed by an offset and a size per
+ * polygon, and the planes are only calculated when they are first needed.
+ * The CGALPolygon objects are lightweight handles onto these arrays.
+ */
+class CGALPolygonSoup
+{
+	Q_DISABLE_COPY_MOVE(CGALPolygonSoup)
+public:
+	using size_type=Polygon::size_type;
+	using const_iterator=QList<CGALPolygon*>::const_iterator;
+
+	explicit CGALPolygonSoup(class CGALPrimitive&);
+
+	CGALPolygon& create();
+	void clear();
+	void swap(CGALPolygonSoup&);
+
+	const QList<CGALPolygon*>& getPolygons() const;
+	const_iterator begin() const;
+	const_iterator end() const;
+	bool isEmpty() const;
+	size_type size() const;
+	CGALPolygon* constLast() const;
+
+private:
+	friend class CGALPolygon;
+	void append(size_type,size_type);
+	void prepend(size_type,size_type);
+	void assign(size_type,const Polygon::Indexes&);
+	Polygon::Indexes getIndexes(size_type) const;
+	bool hasPlane(size_type) const;
+	const CGAL::Plane3& getPlane(size_type) const;
+	void setPlane(size_type,const CGAL::Plane3&);
+	bool atEnd(size_type) const;
+	void moveToEnd(size_type);
+	void compact();
+
+	CGALPrimitive& primitive;
+	QVector<size_type> indexes;
+	QVector<size_type> offsets;
+	QVector<size_type> sizes;
+	QVector<CGAL::Plane3> planes;
+	QVector<bool> calculated;
+	size_type unused;
+	std::deque<CGALPolygon> handles;
+	QList<CGALPolygon*> polygons;
+};
+
+#endif // CGALPOLYGONSOUP_H
+#endif
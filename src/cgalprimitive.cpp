@@ -23,9 +23,13 @@
 #include "cgaldiscretemodifier.h"
 #include "cgalexplorer.h"
 #include "cgalgroupmodifier.h"
+#include "cgalrepair.h"
 #include "cgalsanitizer.h"
+#include "evaluationprogress.h"
+#include "evaluationsettings.h"
 #include "module/cubemodule.h"
 #include "onceonly.h"
+#include "reporter.h"
 #include "rmath.h"
 
 #include <CGAL/Alpha_shape_3.h>
@@ -50,6 +54,7 @@
 #include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/Midpoint_placement.h>
 #include <CGAL/Surface_mesh_simplification/edge_collapse.h>
 #include <CGAL/bounding_box.h>
+#include <CGAL/box_intersection_d.h>
 #if CGAL_VERSION_NR >= CGAL_VERSION_NUMBER(4,12,2)
 #include <CGAL/boost/graph/convert_nef_polyhedron_to_polygon_mesh.h>
 #endif
@@ -58,11 +63,20 @@
 #include <CGAL/convex_hull_3.h>
 #include <CGAL/minkowski_sum_3.h>
 #include <QPair>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
 
 CGALPrimitive::CGALPrimitive() :
+	polygons(*this),
+	perimeters(*this),
 	nefPolyhedron(nullptr),
 	type(PrimitiveTypes::Volume),
-	sanitized(true)
+	sanitized(true),
+	boundsExact(false),
+	boundsConservative(false)
 {
 }
 
@@ -76,17 +90,22 @@ CGALPrimitive::CGALPrimitive(const CGAL::NefPolyhedron3& nef) : CGALPrimitive()
 	nefPolyhedron=new CGAL::NefPolyhedron3(nef);
 }
 
+CGALPrimitive::CGALPrimitive(const QSharedPointer<const InstanceBase>& base) : CGALPrimitive()
+{
+	instances.append(Instance{base,CGAL::AffTransformation3(CGAL::IDENTITY),base->boundingBox});
+	boundingBox=base->boundingBox;
+	boundsConservative=true;
+}
+
 CGALPrimitive::~CGALPrimitive()
 {
 	delete nefPolyhedron;
 	nefPolyhedron=nullptr;
 
 	clearPolygons();
-	qDeleteAll(perimeters);
 	perimeters.clear();
 
-	pointMap.clear();
-	points.clear();
+	clearPoints();
 
 	qDeleteAll(children);
 	children.clear();
@@ -94,10 +113,15 @@ CGALPrimitive::~CGALPrimitive()
 
 void CGALPrimitive::clearPolygons()
 {
-	qDeleteAll(polygons);
 	polygons.clear();
 }
 
+void CGALPrimitive::clearPoints()
+{
+	pointMap.clear();
+	points.clear();
+}
+
 void CGALPrimitive::setType(PrimitiveTypes t)
 {
 	type=t;
@@ -123,6 +147,11 @@ void CGALPrimitive::buildPrimitive()
 	if(nefPolyhedron)
 		return;
 
+	if(!instances.isEmpty()) {
+		nefPolyhedron=createFromInstances();
+		return;
+	}
+
 	switch(type) {
 
 		case PrimitiveTypes::Volume: {
@@ -149,29 +178,112 @@ void CGALPrimitive::buildPrimitive()
 	}
 }
 
-CGAL::NefPolyhedron3* CGALPrimitive::createVolume()
+CGAL::NefPolyhedron3* CGALPrimitive::createFromInstances()
 {
+	CGAL::Nef_nary_union_3<CGAL::NefPolyhedron3> nary;
+	for(const auto& i: std::as_const(instances)) {
+		EvaluationProgress::check();
+		CGAL::NefPolyhedron3 placed(i.base->nefPolyhedron);
+		placed.transform(i.transform);
+		nary.add_polyhedron(placed);
+	}
+	instances.clear();
+	return new CGAL::NefPolyhedron3(nary.get_union());
+}
+
+void CGALPrimitive::repair(Reporter& r)
+{
+	/* Build a volume that was not sanitized now rather than when it is
+	 * first used, so that the repairs made to it can be reported */
+	if(nefPolyhedron||sanitized||type!=PrimitiveTypes::Volume||!instances.isEmpty())
+		return;
+	nefPolyhedron=createVolume(&r);
+}
+
+CGAL::NefPolyhedron3* CGALPrimitive::createVolume(Reporter* r)
+{
+	/* No more vertices are added once the volume is built, so the lookup
+	 * of the points is not needed even if the build falls back to the
+	 * facets */
+	pointMap.clear();
+
 	CGALBuilder b(*this);
 	CGAL::Polyhedron3 poly;
 	poly.delegate(b);
-	if(!b.getComplete())
-		return createFromFacets();
-
-	if(!sanitized) {
+	bool valid=b.getComplete();
+	if(valid && !sanitized) {
 		CGALSanitizer s(poly);
 		setSanitized(s.sanitize());
-		if(!sanitized)
-			return createFromFacets();
+		valid=sanitized;
+		if(valid && r && s.hasRepairs())
+			r->reportMessage(s.getSummary());
 	}
 
+	/* The union of one Nef polyhedron per facet is very slow for large
+	 * meshes so try to repair the soup into a closed polyhedron first */
+	if(!valid && !repairVolume(poly,r))
+		return createFromFacets();
+
 	if(poly.empty())
 		return new CGAL::NefPolyhedron3();
 
+	/* The points and polygons are only staging for the polyhedron, free
+	 * them before the Nef polyhedron is constructed so that there are
+	 * never more than two copies of a large mesh alive at once. A well
+	 * formed mesh has already freed them while it was being built. */
+	clearPolygons();
+	clearPoints();
+
 	return new CGAL::NefPolyhedron3(poly);
 }
 
+bool CGALPrimitive::repairVolume(CGAL::Polyhedron3& poly,Reporter* reporter)
+{
+	if(type!=PrimitiveTypes::Volume)
+		return false;
+
+	CGALRepair::Points soupPoints(points.begin(),points.end());
+	CGALRepair::Polygons soupPolygons;
+	soupPolygons.reserve(polygons.size());
+	for(CGALPolygon* pg: polygons) {
+		const auto& indexes=pg->getIndexes();
+		soupPolygons.emplace_back(indexes.begin(),indexes.end());
+	}
+
+	/* Holes are not filled, so a mesh that is open still becomes the
+	 * union of its facets as it did before */
+	poly.clear();
+	CGALRepair r(soupPoints,soupPolygons);
+	if(!r.repair(poly))
+		return false;
+
+	if(reporter && r.hasRepairs())
+		reporter->reportMessage(r.getSummary());
+
+	setSanitized(true);
+	return true;
+}
+
+/* Copies of a Nef polyhedron share its representation, which the public
+ * operations such as transform clone before they modify it. Modifiers and
+ * the convex decomposition work on the representation directly, so it
+ * has to be cloned before they are used on a shared polyhedron. The
+ * protected member is only named through the derived class, it is called
+ * on the polyhedron itself which is not a NefDetacher */
+struct NefDetacher : public CGAL::NefPolyhedron3
+{
+	using CGAL::NefPolyhedron3::clone_rep;
+};
+
+static void detach(CGAL::NefPolyhedron3& p)
+{
+	if(p.is_shared())
+		(p.*&NefDetacher::clone_rep)();
+}
+
 static void markBoundedVolumes(CGAL::NefPolyhedron3& p)
 {
+	detach(p);
 	CGAL::Mark_bounded_volumes<CGAL::NefPolyhedron3> mbv;
 	p.delegate(mbv,false,false);
 }
@@ -330,16 +442,12 @@ CGAL::NefPolyhedron3* CGALPrimitive::createPoints()
 
 CGALPolygon& CGALPrimitive::createPolygon()
 {
-	auto* pg = new CGALPolygon(*this);
-	polygons.append(pg);
-	return *pg;
+	return polygons.create();
 }
 
 CGALPolygon& CGALPrimitive::createPerimeter()
 {
-	auto* pg = new CGALPolygon(*this);
-	perimeters.append(pg);
-	return *pg;
+	return perimeters.create();
 }
 
 void CGALPrimitive::createVertex(const CGAL::Scalar& x,const CGAL::Scalar& y,const CGAL::Scalar& z)
@@ -351,6 +459,7 @@ void CGALPrimitive::createVertex(const CGAL::Scalar& x,const CGAL::Scalar& y,con
 void CGALPrimitive::createVertex(const CGAL::Point3& p)
 {
 	points.append(p);
+	invalidateBounds();
 }
 
 CGALPrimitive::size_type CGALPrimitive::findIndex(const CGAL::Point3& p)
@@ -368,7 +477,7 @@ CGALPrimitive::size_type CGALPrimitive::findIndex(const CGAL::Point3& p)
 
 void CGALPrimitive::appendVertex(const CGAL::Point3& p)
 {
-	if(!polygons.empty())
+	if(!polygons.isEmpty())
 		appendVertex(polygons.constLast(),p,true);
 }
 
@@ -391,7 +500,7 @@ bool CGALPrimitive::overlaps(Primitive* a,Primitive* b) const
 	auto* pa=dynamic_cast<CGALPrimitive*>(a);
 	auto* pb=dynamic_cast<CGALPrimitive*>(b);
 	if(!pa||!pb) return false;
-	return CGAL::do_intersect(pa->getBounds(),pb->getBounds());
+	return CGAL::do_overlap(pa->getBoundingBox(),pb->getBoundingBox());
 }
 
 Primitive* CGALPrimitive::groupAppend(Primitive* pr)
@@ -402,9 +511,14 @@ Primitive* CGALPrimitive::groupAppend(Primitive* pr)
 		pr->appendChild(this);
 		return pr;
 	}
+	if(appendInstances(that))
+		return this;
+
 	this->buildPrimitive();
 	that->buildPrimitive();
 
+	expandBounds(that);
+	detach(*nefPolyhedron);
 	CGALGroupModifier m(*that->nefPolyhedron);
 	nefPolyhedron->delegate(m,true,false);
 
@@ -416,7 +530,8 @@ Primitive* CGALPrimitive::groupAppend(Primitive* pr)
 Primitive* CGALPrimitive::group(Primitive* pr)
 {
 	groupAppend(pr);
-	markBoundedVolumes(*nefPolyhedron);
+	if(nefPolyhedron)
+		markBoundedVolumes(*nefPolyhedron);
 	return this;
 }
 
@@ -477,16 +592,72 @@ Primitive* CGALPrimitive::joinAll(const QList<Primitive*>& primitives) const
 
 const QList<CGALPolygon*>& CGALPrimitive::getCGALPolygons() const
 {
-	return polygons;
+	return polygons.getPolygons();
 }
 
 const QList<CGALPolygon*>& CGALPrimitive::getCGALPerimeter() const
 {
-	return perimeters;
+	return perimeters.getPolygons();
+}
+
+const QList<CGALPrimitive::Instance>& CGALPrimitive::getInstances() const
+{
+	return instances;
+}
+
+bool CGALPrimitive::appendInstances(CGALPrimitive* that)
+{
+	/* Instances that are apart can simply be placed alongside each other,
+	 * anything that touches has to be merged by the boolean operation */
+	if(instances.isEmpty()||that->instances.isEmpty()||instancesOverlap(that))
+		return false;
+
+	expandBounds(that);
+	instances.append(that->instances);
+	that->instances.clear();
+	/* Nothing is left of the other primitive once its instances are
+	 * taken, so only its children are kept */
+	appendChildren(that->children);
+	that->children.clear();
+	delete that;
+	return true;
+}
+
+bool CGALPrimitive::instancesOverlap(const CGALPrimitive* that) const
+{
+	using Box = CGAL::Box_intersection_d::Box_with_info_d<double,3,int>;
+
+	if(!CGAL::do_overlap(getBoundingBox(),that->getBoundingBox()))
+		return false;
+
+	std::vector<Box> a;
+	std::vector<Box> b;
+	a.reserve(instances.size());
+	b.reserve(that->instances.size());
+	for(const auto& i: instances)
+		a.emplace_back(i.boundingBox,0);
+	for(const auto& i: that->instances)
+		b.emplace_back(i.boundingBox,1);
+
+	bool overlapping=false;
+	CGAL::box_intersection_d(a.begin(),a.end(),b.begin(),b.end(),[&overlapping](const Box&,const Box&) {
+		overlapping=true;
+	});
+	return overlapping;
 }
 
 QList<CGAL::Point3> CGALPrimitive::getPoints() const
 {
+	if(!instances.isEmpty()) {
+		QList<CGAL::Point3> pts;
+		for(const auto& i: instances) {
+			const CGAL::NefPolyhedron3& n=i.base->nefPolyhedron;
+			for(auto v=n.vertices_begin(); v!=n.vertices_end(); ++v)
+				pts.append(v->point().transform(i.transform));
+		}
+		return pts;
+	}
+
 	if(!nefPolyhedron)
 		return points;
 
@@ -500,9 +671,87 @@ QList<CGAL::Point3> CGALPrimitive::getPoints() const
 
 CGAL::Cuboid3 CGALPrimitive::getBounds() const
 {
+	if(boundsExact)
+		return bounds;
+
 	QList<CGAL::Point3> pts=getPoints();
-	if(pts.isEmpty()) return CGAL::Cuboid3();
-	return CGAL::bounding_box(pts.begin(),pts.end());
+	bounds=pts.isEmpty()?CGAL::Cuboid3():CGAL::bounding_box(pts.begin(),pts.end());
+	boundsExact=true;
+	return bounds;
+}
+
+CGAL::Bbox_3 CGALPrimitive::getBoundingBox() const
+{
+	if(!boundsExact && boundsConservative)
+		return boundingBox;
+
+	return getBounds().bbox();
+}
+
+void CGALPrimitive::invalidateBounds()
+{
+	boundsExact=false;
+	boundsConservative=false;
+}
+
+void CGALPrimitive::expandBounds(const CGALPrimitive* that)
+{
+	const bool known=boundsExact||boundsConservative;
+	const bool thatKnown=that->boundsExact||that->boundsConservative;
+	if(!known||!thatKnown) {
+		invalidateBounds();
+		return;
+	}
+	boundingBox=getBoundingBox()+that->getBoundingBox();
+	boundsExact=false;
+	boundsConservative=true;
+}
+
+void CGALPrimitive::keepBounds()
+{
+	if(!boundsExact)
+		return;
+	boundingBox=bounds.bbox();
+	boundsExact=false;
+	boundsConservative=true;
+}
+
+static bool preservesAxes(const CGAL::AffTransformation3& t)
+{
+	for(auto i=0; i<3; ++i) {
+		auto n=0;
+		for(auto j=0; j<3; ++j)
+			if(t.m(i,j)!=0) ++n;
+		if(n>1) return false;
+	}
+	return true;
+}
+
+static CGAL::Bbox_3 transformBox(const CGAL::Bbox_3& b,const CGAL::AffTransformation3& t)
+{
+	CGAL::Bbox_3 result;
+	for(auto i=0; i<8; ++i) {
+		const CGAL::Point3 c(i&1?b.xmax():b.xmin(),i&2?b.ymax():b.ymin(),i&4?b.zmax():b.zmin());
+		result+=c.transform(t).bbox();
+	}
+	return result;
+}
+
+void CGALPrimitive::transformBounds(const CGAL::AffTransformation3& t)
+{
+	if(boundsExact && preservesAxes(t)) {
+		bounds=CGAL::Cuboid3(bounds.min().transform(t),bounds.max().transform(t));
+		return;
+	}
+
+	if(!boundsExact && !boundsConservative)
+		return;
+
+	/* Otherwise the box of the transformed corners still encloses the
+	 * geometry, although no longer tightly */
+	boundingBox=transformBox(getBoundingBox(),t);
+	boundsExact=false;
+	boundsConservative=true;
 }
 
 void CGALPrimitive::groupLater(Primitive* pr)
@@ -518,6 +767,27 @@ void CGALPrimitive::groupLater(Primitive* pr)
 	groupable.append(pr);
 }
 
+/* Lazily evaluated coordinates share their representations, which are
+ * updated in place when they are evaluated. Points that are handed to
+ * the thread pool are copied from their exact values beforehand so that
+ * no two tasks share a representation */
+static CGAL::Scalar exactCopy(const CGAL::Scalar& s)
+{
+	mpq_t q;
+	mpq_init(q);
+	mpq_set(q,to_mpq(s));
+	return to_decimal(q);
+}
+
+static QList<CGAL::Point3> exactCopy(const QList<CGAL::Point3>& points)
+{
+	QList<CGAL::Point3> copy;
+	copy.reserve(points.size());
+	for(const auto& p: points)
+		copy.append(CGAL::Point3(exactCopy(p.x()),exactCopy(p.y()),exactCopy(p.z())));
+	return copy;
+}
+
 void CGALPrimitive::joinLater(Primitive* pr)
 {
 	joinable.append(pr);
@@ -525,6 +795,20 @@ void CGALPrimitive::joinLater(Primitive* pr)
 
 Primitive* CGALPrimitive::combine()
 {
+	/* The hulls between the links of a chain are independent so compute
+	 * them all at once, with the settings of the calling thread */
+	if(!chainHulls.empty()) {
+		const EvaluationSettings settings=EvaluationSettings::current();
+		const auto& hulls=QtConcurrent::blockingMapped<QList<Primitive*>>(chainHulls,[settings](const QList<CGAL::Point3>& pts) {
+			const EvaluationSettings::Scope scope(settings);
+			auto* cp=new CGALPrimitive();
+			return cp->hull(pts);
+		});
+		chainHulls.clear();
+		for(Primitive* h: hulls)
+			joinLater(h);
+	}
+
 	if(groupable.empty()&&joinable.empty())
 		return this;
 
@@ -550,8 +834,13 @@ Primitive* CGALPrimitive::join(Primitive* pr)
 		pr->appendChild(this);
 		return pr;
 	}
+	if(appendInstances(that))
+		return this;
+
 	this->buildPrimitive();
 	that->buildPrimitive();
+	expandBounds(that);
+	EvaluationProgress::check();
 	*nefPolyhedron=nefPolyhedron->join(*that->nefPolyhedron);
 	this->appendChild(that);
 	return this;
@@ -567,6 +856,8 @@ Primitive* CGALPrimitive::intersection(Primitive* pr)
 	}
 	this->buildPrimitive();
 	that->buildPrimitive();
+	keepBounds();
+	EvaluationProgress::check();
 	*nefPolyhedron=nefPolyhedron->intersection(*that->nefPolyhedron);
 	this->appendChild(that);
 	return this;
@@ -582,6 +873,8 @@ Primitive* CGALPrimitive::difference(Primitive* pr)
 	}
 	this->buildPrimitive();
 	that->buildPrimitive();
+	keepBounds();
+	EvaluationProgress::check();
 	*nefPolyhedron=nefPolyhedron->difference(*that->nefPolyhedron);
 	this->appendChild(that);
 	return this;
@@ -597,6 +890,8 @@ Primitive* CGALPrimitive::symmetric_difference(Primitive* pr)
 	}
 	this->buildPrimitive();
 	that->buildPrimitive();
+	expandBounds(that);
+	EvaluationProgress::check();
 	*nefPolyhedron=nefPolyhedron->symmetric_difference(*that->nefPolyhedron);
 	this->appendChild(that);
 	return this;
@@ -612,11 +907,156 @@ Primitive* CGALPrimitive::minkowski(Primitive* pr)
 	}
 	this->buildPrimitive();
 	that->buildPrimitive();
-	*nefPolyhedron=CGAL::minkowski_sum_3(*nefPolyhedron,*that->nefPolyhedron);
+
+	/* The sum of the boxes encloses the sum of their contents */
+	if((boundsExact||boundsConservative)&&(that->boundsExact||that->boundsConservative)) {
+		const CGAL::Bbox_3& ba=getBoundingBox();
+		const CGAL::Bbox_3& bb=that->getBoundingBox();
+		boundingBox=CGAL::Bbox_3(ba.xmin()+bb.xmin(),ba.ymin()+bb.ymin(),ba.zmin()+bb.zmin(),
+								 ba.xmax()+bb.xmax(),ba.ymax()+bb.ymax(),ba.zmax()+bb.zmax());
+		boundsExact=false;
+		boundsConservative=true;
+	} else {
+		invalidateBounds();
+	}
+
+	/* The sum of two convex parts is the hull of the pairwise sums of
+	 * their vertices, so rather than leaving minkowski_sum_3 to decompose
+	 * both operands, skip the decomposition of operands that are already
+	 * convex and compute the hulls of all the pairs of parts in parallel.
+	 * The hull of the sums is only fully dimensional when one of the
+	 * operands is, otherwise use the general algorithm. */
+	const bool thisVolume=isFullyDimentional();
+	const bool thatVolume=that->isFullyDimentional();
+	const bool thisSimple=thisVolume||type==PrimitiveTypes::Lines||type==PrimitiveTypes::Points;
+	const bool thatSimple=thatVolume||that->type==PrimitiveTypes::Lines||that->type==PrimitiveTypes::Points;
+	ConvexParts a;
+	ConvexParts b;
+	if((thisVolume||thatVolume) && thisSimple && thatSimple) {
+		a=getConvexParts();
+		b=that->getConvexParts();
+	}
+	EvaluationProgress::check();
+	if(a.isEmpty()||b.isEmpty()) {
+		*nefPolyhedron=CGAL::minkowski_sum_3(*nefPolyhedron,*that->nefPolyhedron);
+		this->appendChild(that);
+		return this;
+	}
+
+	/* Every pair gets its own copy of the points of its parts */
+	using Pair=QPair<QList<CGAL::Point3>,QList<CGAL::Point3>>;
+	QList<Pair> pairs;
+	for(const auto& pa: std::as_const(a))
+		for(const auto& pb: std::as_const(b))
+			pairs.append(qMakePair(exactCopy(pa),exactCopy(pb)));
+
+	/* There can be very many pairs, so allow the evaluation to be
+	 * cancelled between them */
+	EvaluationProgress* progress=EvaluationProgress::current();
+	const EvaluationSettings settings=EvaluationSettings::current();
+	const QList<CGAL::NefPolyhedron3>& sums=QtConcurrent::blockingMapped<QList<CGAL::NefPolyhedron3>>(pairs,[progress,settings](const Pair& p) {
+		const EvaluationProgress::Scope active(progress);
+		const EvaluationSettings::Scope scope(settings);
+		EvaluationProgress::check();
+		return convexSum(p.first,p.second);
+	});
+
+	if(sums.size()==1) {
+		*nefPolyhedron=sums.first();
+	} else {
+		CGAL::Nef_nary_union_3<CGAL::NefPolyhedron3> nary;
+		for(const auto& n: sums) {
+			EvaluationProgress::check();
+			nary.add_polyhedron(n);
+		}
+		*nefPolyhedron=nary.get_union();
+	}
 	this->appendChild(that);
 	return this;
 }
 
+bool CGALPrimitive::isConvex(const CGAL::Polyhedron3& poly)
+{
+	/* A closed connected surface is convex when none of its edges are
+	 * reflex, i.e. no facet sees the far vertex of its neighbour from its
+	 * outer side */
+	for(auto h=poly.halfedges_begin(); h!=poly.halfedges_end(); ++h) {
+		if(h->is_border()||h->opposite()->is_border())
+			return false;
+		const CGAL::Point3& p=h->vertex()->point();
+		const CGAL::Point3& q=h->next()->vertex()->point();
+		const CGAL::Point3& r=h->next()->next()->vertex()->point();
+		const CGAL::Point3& s=h->opposite()->next()->vertex()->point();
+		if(CGAL::Plane3(p,q,r).oriented_side(s)==CGAL::ON_POSITIVE_SIDE)
+			return false;
+	}
+	return true;
+}
+
+CGALPrimitive::ConvexParts CGALPrimitive::getConvexParts()
+{
+	ConvexParts parts;
+	if(type==PrimitiveTypes::Lines) {
+		CGAL::NefPolyhedron3::Halfedge_const_iterator e;
+		CGAL_forall_edges(e,*nefPolyhedron->sncp()) {
+			QList<CGAL::Point3> segment;
+			segment.append(e->source()->point());
+			segment.append(e->twin()->source()->point());
+			parts.append(segment);
+		}
+	}
+	if(type==PrimitiveTypes::Points||(type==PrimitiveTypes::Lines&&parts.isEmpty())) {
+		for(const auto& pt: getPoints()) {
+			QList<CGAL::Point3> point;
+			point.append(pt);
+			parts.append(point);
+		}
+		return parts;
+	}
+	if(type!=PrimitiveTypes::Volume)
+		return parts;
+
+	CGAL::Polyhedron3* poly=getPolyhedron();
+	const bool convex=nefPolyhedron->number_of_volumes()==2 && isConvex(*poly);
+	if(convex) {
+		QList<CGAL::Point3> pts;
+		for(auto v=poly->vertices_begin(); v!=poly->vertices_end(); ++v)
+			pts.append(v->point());
+		parts.append(pts);
+	}
+	delete poly;
+	if(convex)
+		return parts;
+
+	CGAL::NefPolyhedron3 decomposed(*nefPolyhedron);
+	detach(decomposed);
+	CGAL::convex_decomposition_3(decomposed);
+	using VolumeIterator = CGAL::NefPolyhedron3::Volume_const_iterator;
+	for(VolumeIterator ci=++decomposed.volumes_begin(); ci!=decomposed.volumes_end(); ++ci) {
+		if(ci->mark()) {
+			CGAL::Polyhedron3 p;
+			decomposed.convert_inner_shell_to_polyhedron(ci->shells_begin(),p);
+			QList<CGAL::Point3> pts;
+			for(auto v=p.vertices_begin(); v!=p.vertices_end(); ++v)
+				pts.append(v->point());
+			parts.append(pts);
+		}
+	}
+	return parts;
+}
+
+CGAL::NefPolyhedron3 CGALPrimitive::convexSum(const QList<CGAL::Point3>& a,const QList<CGAL::Point3>& b)
+{
+	QList<CGAL::Point3> sums;
+	for(const auto& p: a)
+		for(const auto& q: b)
+			sums.append(p+(q-CGAL::ORIGIN));
+
+	CGAL::Polyhedron3 hull;
+	CGAL::convex_hull_3(sums.begin(),sums.end(),hull);
+	return CGAL::NefPolyhedron3(hull);
+}
+
 Primitive* CGALPrimitive::inset(const CGAL::Scalar& amount)
 {
 	if(isFullyDimentional())
@@ -631,6 +1071,7 @@ Primitive* CGALPrimitive::inset(const CGAL::Scalar& amount)
 Primitive* CGALPrimitive::decompose()
 {
 	this->buildPrimitive();
+	detach(*nefPolyhedron);
 	CGAL::convex_decomposition_3(*nefPolyhedron);
 
 	using VolumeIterator = CGAL::NefPolyhedron3::Volume_const_iterator;
@@ -650,6 +1091,7 @@ Primitive* CGALPrimitive::decompose()
 Primitive* CGALPrimitive::complement()
 {
 	this->buildPrimitive();
+	invalidateBounds();
 	*nefPolyhedron=nefPolyhedron->complement();
 	return this;
 }
@@ -672,18 +1114,18 @@ Primitive* CGALPrimitive::boundary()
 void CGALPrimitive::convertBoundary()
 {
 	setType(PrimitiveTypes::Lines);
-	polygons=perimeters;
-	perimeters.clear();
+	clearPolygons();
+	polygons.swap(perimeters);
 }
 
 void CGALPrimitive::detectPerimeterHoles()
 {
-	detectHoles(perimeters,false);
+	detectHoles(perimeters.getPolygons(),false);
 }
 
 bool CGALPrimitive::hasHoles()
 {
-	return detectHoles(polygons,true);
+	return detectHoles(polygons.getPolygons(),true);
 }
 
 bool CGALPrimitive::detectHoles(QList<CGALPolygon*> polys,bool check)
@@ -829,6 +1271,8 @@ Point CGALPrimitive::locate(const Point& s,const Point& t)
 	enum { Vertex=1, Edge=2, Facet=4};
 
 	CGAL::Point3 p;
+	if(!instances.isEmpty())
+		buildPrimitive();
 	if(nefPolyhedron) {
 		auto& locator=static_cast<NefLocator&>(*nefPolyhedron);
 		const Ray3 ray(s,t);
@@ -964,18 +1408,42 @@ Primitive* CGALPrimitive::rotate_extrude(const CGAL::Scalar& height,const CGAL::
 Primitive* CGALPrimitive::copy()
 {
 	auto* p=new CGALPrimitive();
-	this->buildPrimitive();
-	p->nefPolyhedron=new CGAL::NefPolyhedron3(*nefPolyhedron);
+	if(!instances.isEmpty()) {
+		/* The instances of the copy are placed from the same shared geometry */
+		p->instances=instances;
+	} else {
+		this->buildPrimitive();
+		/* The copy shares the representation until either side modifies it */
+		p->nefPolyhedron=new CGAL::NefPolyhedron3(*nefPolyhedron);
+	}
+	p->bounds=bounds;
+	p->boundsExact=boundsExact;
+	p->boundingBox=boundingBox;
+	p->boundsConservative=boundsConservative;
 	return p;
 }
 
+CGALPrimitive* CGALPrimitive::clone()
+{
+	/* The geometry that instances are placed from is never modified, so
+	 * only a nef polyhedron of its own needs to be detached */
+	auto* p=dynamic_cast<CGALPrimitive*>(copy());
+	if(p->nefPolyhedron)
+		detach(*p->nefPolyhedron);
+	return p;
+}
 
 void CGALPrimitive::transform(TransformMatrix* matrix)
 {
 	if(!matrix) return;
 
 	const CGAL::AffTransformation3& t=matrix->getTransform();
-	if(nefPolyhedron) {
+	if(!instances.isEmpty()) {
+		for(auto& i: instances) {
+			i.transform=t*i.transform;
+			i.boundingBox=transformBox(i.base->boundingBox,i.transform);
+		}
+	} else if(nefPolyhedron) {
 		nefPolyhedron->transform(t);
 	} else {
 		QList<CGAL::Point3> transformedPoints;
@@ -984,6 +1452,7 @@ void CGALPrimitive::transform(TransformMatrix* matrix)
 		}
 		points=std::move(transformedPoints);
 	}
+	transformBounds(t);
 
 	//Only transform auxilliary modules children.
 	for(Primitive* p: getChildren())
@@ -1017,6 +1486,9 @@ CGAL::Polyhedron3* CGALPrimitive::getPolyhedron()
 
 bool CGALPrimitive::isEmpty()
 {
+	if(!instances.isEmpty())
+		return false;
+
 	this->buildPrimitive();
 	return nefPolyhedron->is_empty();
 }
@@ -1045,15 +1517,24 @@ CGAL::Circle3 CGALPrimitive::getRadius() const
 
 CGALVolume CGALPrimitive::getVolume(bool calcMass)
 {
-	this->buildPrimitive();
-	Primitive* p=copy();
-	p=p->decompose();
+	/* The mass properties only depend on the boundary so there is no need
+	 * to decompose the polyhedron into convex parts and triangulate them,
+	 * a fan of each facet is enough */
+	CGAL::Polyhedron3* poly=getPolyhedron();
+	QList<CGAL::Triangle3> triangles;
+	for(auto fi=poly->facets_begin(); fi!=poly->facets_end(); ++fi) {
+		auto hc=fi->facet_begin();
+		const CGAL::Point3& p0=(hc++)->vertex()->point();
+		CGAL::Point3 p1=(hc++)->vertex()->point();
+		do {
+			const CGAL::Point3& p2=hc->vertex()->point();
+			triangles.append(CGAL::Triangle3(p0,p1,p2));
+			p1=p2;
+		} while(++hc!=fi->facet_begin());
+	}
+	delete poly;
 
-	CGALExplorer e(p);
-	CGALVolume v=e.getVolume(calcMass);
-	delete e.getPrimitive();
-	delete p;
-	return v;
+	return CGALVolume::fromTriangles(triangles,calcMass);
 }
 
 bool CGALPrimitive::isFullyDimentional()
@@ -1061,6 +1542,10 @@ bool CGALPrimitive::isFullyDimentional()
 	if(getType() != PrimitiveTypes::Volume)
 		return false;
 
+	/* Only fully dimentional volumes are shared as instances */
+	if(!instances.isEmpty())
+		return true;
+
 	this->buildPrimitive();
 	//For fully dimentional polyhedra there are always two volumes the outer
 	//volume and the inner volume. So check volumes > 1
@@ -1085,8 +1570,12 @@ void CGALPrimitive::appendChildren(QList<Primitive*> p)
 
 void CGALPrimitive::discrete(int places)
 {
+	if(!instances.isEmpty())
+		buildPrimitive();
+	invalidateBounds();
 	if(nefPolyhedron) {
 		CGALDiscreteModifier n(places);
+		detach(*nefPolyhedron);
 		nefPolyhedron->delegate(n,false,false);
 	} else {
 		QList<CGAL::Point3> discretePoints;
@@ -1314,6 +1803,97 @@ void CGALPrimitive::resize(bool autosize, const CGAL::Point3& s)
 	transform(&t);
 }
 
+/* Points strictly inside the polytope spanned by the extreme points in a
+ * few directions can't be on the hull. The test is done with doubles and
+ * keeps any point within a tolerance of the surface, since only
+ * discarding points that would be kept by the exact hull is harmful. */
+static QList<CGAL::Point3> discardInterior(const QList<CGAL::Point3>& pts)
+{
+	if(pts.size()<64)
+		return pts;
+
+	struct Vec { double x,y,z; };
+	QVector<Vec> v;
+	v.reserve(pts.size());
+	double scale=0.0;
+	for(const auto& p: pts) {
+		const Vec d{CGAL::to_double(p.x()),CGAL::to_double(p.y()),CGAL::to_double(p.z())};
+		scale=std::max({scale,std::abs(d.x),std::abs(d.y),std::abs(d.z)});
+		v.append(d);
+	}
+
+	static const int directions[][3]={
+		{1,0,0},{-1,0,0},{0,1,0},{0,-1,0},{0,0,1},{0,0,-1},
+		{1,1,1},{1,1,-1},{1,-1,1},{1,-1,-1},{-1,1,1},{-1,1,-1},{-1,-1,1},{-1,-1,-1}
+	};
+	QList<CGAL::Point3> extremes;
+	for(const auto& d: directions) {
+		int best=0;
+		double max=-std::numeric_limits<double>::infinity();
+		for(auto i=0; i<v.size(); ++i) {
+			const double dot=v[i].x*d[0]+v[i].y*d[1]+v[i].z*d[2];
+			if(dot>max) {
+				max=dot;
+				best=i;
+			}
+		}
+		if(!extremes.contains(pts.at(best)))
+			extremes.append(pts.at(best));
+	}
+
+	CGAL::Object o;
+	CGAL::convex_hull_3(extremes.begin(),extremes.end(),o);
+	const auto* poly=CGAL::object_cast<CGAL::Polyhedron3>(&o);
+	if(!poly||!poly->is_closed()||poly->size_of_facets()<4)
+		return pts;
+
+	struct Plane { Vec n; double d; double tolerance; };
+	QVector<Plane> planes;
+	for(auto f=poly->facets_begin(); f!=poly->facets_end(); ++f) {
+		auto h=f->facet_begin();
+		const CGAL::Point3& p=(h++)->vertex()->point();
+		const CGAL::Point3& q=(h++)->vertex()->point();
+		const CGAL::Point3& r=h->vertex()->point();
+		const CGAL::Vector3 n=CGAL::cross_product(q-p,r-p);
+		const Vec nd{CGAL::to_double(n.x()),CGAL::to_double(n.y()),CGAL::to_double(n.z())};
+		const double length=std::sqrt(nd.x*nd.x+nd.y*nd.y+nd.z*nd.z);
+		const double d=nd.x*CGAL::to_double(p.x())+nd.y*CGAL::to_double(p.y())+nd.z*CGAL::to_double(p.z());
+		planes.append(Plane{nd,d,length*scale*1e-9});
+	}
+
+	QList<CGAL::Point3> result;
+	for(auto i=0; i<v.size(); ++i) {
+		bool inside=true;
+		for(const auto& pl: std::as_const(planes)) {
+			if(pl.n.x*v[i].x+pl.n.y*v[i].y+pl.n.z*v[i].z-pl.d > -pl.tolerance) {
+				inside=false;
+				break;
+			}
+		}
+		if(!inside)
+			result.append(pts.at(i));
+	}
+	return result;
+}
+
+static QList<CGAL::Point3> hullVertices(const QList<CGAL::Point3>& points)
+{
+	const auto& pts=discardInterior(points);
+	if(pts.size()<4)
+		return pts;
+
+	CGAL::Object o;
+	CGAL::convex_hull_3(pts.begin(),pts.end(),o);
+	const auto* poly=CGAL::object_cast<CGAL::Polyhedron3>(&o);
+	if(!poly||!poly->is_closed())
+		return pts;
+
+	QList<CGAL::Point3> vertices;
+	for(auto v=poly->vertices_begin(); v!=poly->vertices_end(); ++v)
+		vertices.append(v->point());
+	return vertices;
+}
+
 Primitive* CGALPrimitive::hull(bool concave)
 {
 	using Vb = CGAL::Alpha_shape_vertex_base_3<CGAL::Kernel3>;
@@ -1324,13 +1904,28 @@ Primitive* CGALPrimitive::hull(bool concave)
 	using Facet = Alpha_shape_3::Facet;
 
 	QList<CGAL::Point3> pts;
-	for(Primitive* c: getChildren())
-		pts.append(c->getPoints());
-
 	if(!concave) {
+		/* Only the vertices of the hull of each child can be vertices of
+		 * the hull of them all, so reduce each child to those in parallel.
+		 * Children that are instances share their points, so the points
+		 * are gathered first */
+		QList<QList<CGAL::Point3>> points;
+		for(Primitive* c: getChildren())
+			points.append(exactCopy(c->getPoints()));
+		const EvaluationSettings settings=EvaluationSettings::current();
+		const auto& vertices=QtConcurrent::blockingMapped<QList<QList<CGAL::Point3>>>(points,[settings](const QList<CGAL::Point3>& p) {
+			const EvaluationSettings::Scope scope(settings);
+			return hullVertices(p);
+		});
+		for(const auto& v: vertices)
+			pts.append(v);
+
 		return hull(pts);
 	}
 
+	for(Primitive* c: getChildren())
+		pts.append(c->getPoints());
+
 	Alpha_shape_3 as(pts.begin(), pts.end(),0.001,Alpha_shape_3::GENERAL);
 	const auto& opt = as.find_optimal_alpha(1);
 	if(opt != as.alpha_end()) {
@@ -1366,8 +1961,9 @@ Primitive* CGALPrimitive::hull(bool concave)
 	return this;
 }
 
-Primitive* CGALPrimitive::hull(const QList<CGAL::Point3>& pts)
+Primitive* CGALPrimitive::hull(const QList<CGAL::Point3>& input)
 {
+	const auto& pts=discardInterior(input);
 	CGAL::Object o;
 	CGAL::convex_hull_3(pts.begin(),pts.end(),o);
 	const auto* pt=CGAL::object_cast<CGAL::Point3>(&o);
@@ -1408,8 +2004,9 @@ Primitive* CGALPrimitive::chain_hull(Primitive* previous,Primitive* next)
 	if(next)
 		points.append(next->getPoints());
 
-	auto* cp=new CGALPrimitive();
-	joinLater(cp->hull(points));
+	/* Defer the hull until combine so that all the links are computed
+	 * concurrently. Consecutive links share the points of a child */
+	chainHulls.append(exactCopy(points));
 
 	return this;
 }
@@ -22,14 +22,18 @@
 #include "cgal.h"
 
 #include "cgalpolygon.h"
+#include "cgalpolygonsoup.h"
 #include "cgalvolume.h"
 #include "primitive.h"
 #include <CGAL/Nef_nary_union_3.h>
 #include <CGAL/Nef_polyhedron_3.h>
 #include <CGAL/Polyhedron_3.h>
 #include <QMap>
+#include <QSharedPointer>
 #include <QVector>
 
+class Reporter;
+
 namespace CGAL
 {
 using Polyhedron3 = Polyhedron_3<Kernel3>;
@@ -41,10 +45,29 @@ class CGALPrimitive : public Primitive
 {
 	Q_DISABLE_COPY_MOVE(CGALPrimitive)
 public:
+	/**
+	 * @brief Geometry that is evaluated once and shared by every instance
+	 * placed from it.
+	 */
+	struct InstanceBase {
+		CGAL::NefPolyhedron3 nefPolyhedron;
+		CGAL::Bbox_3 boundingBox;
+	};
+	/**
+	 * @brief A placement of shared geometry together with a box that
+	 * encloses it once placed.
+	 */
+	struct Instance {
+		QSharedPointer<const InstanceBase> base;
+		CGAL::AffTransformation3 transform;
+		CGAL::Bbox_3 boundingBox;
+	};
+
 	CGALPrimitive();
 	~CGALPrimitive() override;
 	explicit CGALPrimitive(const CGAL::Polyhedron3&);
 	explicit CGALPrimitive(const CGAL::NefPolyhedron3&);
+	explicit CGALPrimitive(const QSharedPointer<const InstanceBase>&);
 	bool getSanitized() override;
 	bool isEmpty() override;
 	bool isFullyDimentional() override;
@@ -57,6 +80,12 @@ public:
 	Primitive* combine() override;
 	Primitive* complement() override;
 	Primitive* copy() override;
+	/**
+	 * @brief A copy which does not share the representation of the nef
+	 * polyhedron, so that it can be read by another thread while this
+	 * primitive goes on to be modified.
+	 */
+	CGALPrimitive* clone();
 	Primitive* decompose() override;
 	Primitive* difference(Primitive*) override;
 	Primitive* glide(Primitive*) override;
@@ -93,15 +122,19 @@ public:
 	void transform(TransformMatrix*) override;
 	CGAL::Circle3 getRadius() const;
 	CGAL::Cuboid3 getBounds() const;
+	CGAL::Bbox_3 getBoundingBox() const;
 	CGALPolygon& createPerimeter();
 	CGAL::Polyhedron3* getPolyhedron();
 	CGALVolume getVolume(bool);
 	const CGAL::NefPolyhedron3& getNefPolyhedron();
+	void repair(Reporter&);
 	const QList<CGALPolygon*>& getCGALPerimeter() const;
 	const QList<CGALPolygon*>& getCGALPolygons() const;
+	const QList<Instance>& getInstances() const;
 	void appendVertex(CGALPolygon*,const CGAL::Point3&,bool);
 	void appendVertex(const CGAL::Point3&);
 	void clearPolygons();
+	void clearPoints();
 	void createVertex(const CGAL::Scalar&,const CGAL::Scalar&,const CGAL::Scalar&);
 	void detectPerimeterHoles();
 private:
@@ -111,15 +144,27 @@ private:
 	Primitive* joinAll(const QList<Primitive*>&) const;
 	void buildPrimitive();
 	void convertBoundary();
-	CGAL::NefPolyhedron3* createVolume();
+	CGAL::NefPolyhedron3* createFromInstances();
+	bool appendInstances(CGALPrimitive*);
+	bool instancesOverlap(const CGALPrimitive*) const;
+	CGAL::NefPolyhedron3* createVolume(Reporter* =nullptr);
+	bool repairVolume(CGAL::Polyhedron3&,Reporter*);
 	CGAL::NefPolyhedron3* createFromFacets();
 	CGAL::NefPolyhedron3* createPolyline();
 	static CGAL::NefPolyhedron3* createPolyline(CGALPolygon*);
 	static CGAL::NefPolyhedron3* createPolyline(const CGAL::Segment3&);
 	static CGAL::NefPolyhedron3* createPolyline(const QVector<CGAL::Point3>&);
 	CGAL::NefPolyhedron3* createPoints();
+	using ConvexParts=QList<QList<CGAL::Point3>>;
+	ConvexParts getConvexParts();
+	static bool isConvex(const CGAL::Polyhedron3&);
+	static CGAL::NefPolyhedron3 convexSum(const QList<CGAL::Point3>&,const QList<CGAL::Point3>&);
 	bool detectHoles(QList<CGALPolygon*>,bool);
 	bool hasHoles();
+	void invalidateBounds();
+	void expandBounds(const CGALPrimitive*);
+	void keepBounds();
+	void transformBounds(const CGAL::AffTransformation3&);
 
 	/**
 	 * @brief Find the index of the point or add it to the points list
@@ -132,13 +177,30 @@ private:
 	QList<Primitive*> children;
 	QList<CGAL::Point3> points;
 	QMap<CGAL::Point3,size_type> pointMap;
-	QList<CGALPolygon*> polygons;
-	QList<CGALPolygon*> perimeters;
+	/* The indexes and planes of the polygons are held in flat arrays owned
+	 * by the primitive, the CGALPolygon objects are only handles onto them */
+	CGALPolygonSoup polygons;
+	CGALPolygonSoup perimeters;
 	CGAL::NefPolyhedron3* nefPolyhedron;
 	PrimitiveTypes type;
 	bool sanitized;
 	QList<Primitive*> joinable;
 	QList<Primitive*> groupable;
+	QList<QList<CGAL::Point3>> chainHulls;
+
+	/* A primitive made only of instances has no Nef polyhedron until an
+	 * operation needs the merged geometry, placing the instances only
+	 * composes their transformations. */
+	QList<Instance> instances;
+
+	/* The exact bounds are computed on demand and kept until the
+	 * geometry changes. Operations that can only shrink or grow the
+	 * geometry in a known way keep an enclosing interval box instead,
+	 * which is enough to decide whether two primitives may overlap. */
+	mutable CGAL::Cuboid3 bounds;
+	mutable bool boundsExact;
+	CGAL::Bbox_3 boundingBox;
+	bool boundsConservative;
 };
 
 #endif // CGALPRIMITIVE_H
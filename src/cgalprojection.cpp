@@ -34,6 +34,12 @@ static CGAL::Point2 projectYZ(const CGAL::Point3& p)
 	return CGAL::Point2(p.y(),p.z());
 }
 
+CGALProjection::CGALProjection() :
+	projectFunc(&projectXY),
+	ortho(2)
+{
+}
+
 CGALProjection::CGALProjection(const CGAL::Vector3& v)
 {
 	ortho = CGAL::abs(v[0]) > CGAL::abs(v[1]) ? 0 : 1;
@@ -25,6 +25,7 @@
 class CGALProjection
 {
 public:
+	CGALProjection();
 	explicit CGALProjection(const CGAL::Vector3&);
 	CGAL::Point2 project(const CGAL::Point3&) const;
 	bool operator==(const CGALProjection&) const;
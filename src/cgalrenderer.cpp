@@ -18,10 +18,16 @@
 #ifdef USE_CGAL
 #include "cgalrenderer.h"
 #include "cgalprimitive.h"
+#include "displaylist.h"
 #include "preferences.h"
 #include "primitive.h"
 #include "rmath.h"
 #include <CGAL/glu.h>
+#include <QHash>
+#include <QMatrix4x4>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 #ifndef GLAPIENTRY
 #define GLAPIENTRY
@@ -64,6 +70,7 @@ class FacetF
 	Cycle_vector facetCycles;
 	GLfloat normal[3];
 	Mark mark;
+	CGAL::Plane3 plane;
 
 public:
 
@@ -104,6 +111,16 @@ public:
 		return mark;
 	}
 
+	void setPlane(const CGAL::Plane3& p)
+	{
+		plane=p;
+	}
+
+	const CGAL::Plane3& getPlane() const
+	{
+		return plane;
+	}
+
 	void newFacetCycle()
 	{
 		facetCycles.append(coordinates.size());
@@ -133,6 +150,195 @@ public:
 	}
 };
 
+/* A bounding volume hierarchy over the rendered facets. Rays are traced
+ * through it in floating point so that picking does not depend on the
+ * exact point locator, only the facet that was hit is intersected
+ * exactly. */
+class FacetTree
+{
+	Q_DISABLE_COPY_MOVE(FacetTree)
+
+	static constexpr int leafSize=4;
+
+	struct Node {
+		CGAL::Bbox_3 box;
+		int index; // first facet of a leaf or the right child of a branch
+		int count; // number of facets of a leaf, zero for a branch
+	};
+
+	const QList<FacetF>& facets;
+	int first;
+	QVector<CGAL::Bbox_3> boxes;
+	QVector<int> order;
+	QVector<Node> nodes;
+
+	static double centre(const CGAL::Bbox_3& b,int axis)
+	{
+		return b.min(axis)+b.max(axis);
+	}
+
+	int build(int begin,int end)
+	{
+		CGAL::Bbox_3 box;
+		for(auto i=begin; i<end; ++i)
+			box+=boxes.at(order.at(i)-first);
+
+		const int n=nodes.size();
+		nodes.append(Node{box,begin,end-begin});
+		if(end-begin<=leafSize)
+			return n;
+
+		int axis=0;
+		for(auto a=1; a<3; ++a)
+			if(box.max(a)-box.min(a)>box.max(axis)-box.min(axis))
+				axis=a;
+
+		const int mid=(begin+end)/2;
+		std::nth_element(order.begin()+begin,order.begin()+mid,order.begin()+end,[this,axis](int a,int b) {
+			return centre(boxes.at(a-first),axis)<centre(boxes.at(b-first),axis);
+		});
+
+		build(begin,mid);
+		const int right=build(mid,end);
+		nodes[n].index=right;
+		nodes[n].count=0;
+		return n;
+	}
+
+	static bool hitsBox(const CGAL::Bbox_3& b,const double o[3],const double inv[3],double nearest)
+	{
+		double tmin=0.0;
+		double tmax=nearest;
+		for(auto a=0; a<3; ++a) {
+			double t0=(b.min(a)-o[a])*inv[a];
+			double t1=(b.max(a)-o[a])*inv[a];
+			if(t0>t1) std::swap(t0,t1);
+			tmin=std::max(tmin,t0);
+			tmax=std::min(tmax,t1);
+			if(tmax<tmin) return false;
+		}
+		return true;
+	}
+
+	static bool hitsFacet(const FacetF& f,const double o[3],const double d[3],double& nearest)
+	{
+		if(f.facetCyclesSize()==0) return false;
+
+		const double n[3]={f.dx(),f.dy(),f.dz()};
+		const double denom=n[0]*d[0]+n[1]*d[1]+n[2]*d[2];
+		if(denom==0.0) return false;
+
+		const PointF& p=*f.facetCyclesBegin(0);
+		const double t=(n[0]*(p.x()-o[0])+n[1]*(p.y()-o[1])+n[2]*(p.z()-o[2]))/denom;
+		if(t<0.0||t>=nearest) return false;
+
+		/* Project onto the plane that drops the dominant axis of the
+		 * normal and count the crossings of all the cycles, so that
+		 * holes are excluded */
+		int axis=0;
+		for(auto a=1; a<3; ++a)
+			if(std::abs(n[a])>std::abs(n[axis]))
+				axis=a;
+		const int u=(axis+1)%3;
+		const int v=(axis+2)%3;
+		const double hu=o[u]+t*d[u];
+		const double hv=o[v]+t*d[v];
+
+		bool inside=false;
+		for(uint c=0; c<f.facetCyclesSize(); ++c) {
+			const auto b=f.facetCyclesBegin(c);
+			const auto e=f.facetCyclesEnd(c);
+			if(b==e) continue;
+			for(auto i=b,j=e-1; i!=e; j=i++) {
+				const double iu=(*i)[u],iv=(*i)[v];
+				const double ju=(*j)[u],jv=(*j)[v];
+				if((iv>hv)!=(jv>hv) && hu<(ju-iu)*(hv-iv)/(jv-iv)+iu)
+					inside=!inside;
+			}
+		}
+		if(!inside) return false;
+
+		nearest=t;
+		return true;
+	}
+
+public:
+	FacetTree(const QList<FacetF>& f,int begin,int end) :
+		facets(f),
+		first(begin)
+	{
+		boxes.reserve(end-begin);
+		order.reserve(end-begin);
+		for(auto i=begin; i<end; ++i) {
+			const FacetF& facet=facets.at(i);
+			CGAL::Bbox_3 b;
+			for(uint c=0; c<facet.facetCyclesSize(); ++c)
+				for(auto j=facet.facetCyclesBegin(c); j!=facet.facetCyclesEnd(c); ++j)
+					b+=j->bbox();
+			order.append(i);
+			boxes.append(b);
+		}
+		if(!order.isEmpty())
+			build(0,order.size());
+	}
+
+	/**
+	 * @brief Find the nearest facet hit by the ray from s through t.
+	 * @param nearest The distance along the ray to beat, in multiples of
+	 * the distance from s to t, updated when a nearer facet is hit.
+	 * @return The index of the facet or -1 when nothing nearer was hit.
+	 */
+	int shoot(const QVector3D& s,const QVector3D& t,double& nearest) const
+	{
+		const double o[3]={s.x(),s.y(),s.z()};
+		const double d[3]={t.x()-o[0],t.y()-o[1],t.z()-o[2]};
+		const double inv[3]={1.0/d[0],1.0/d[1],1.0/d[2]};
+
+		int hit=-1;
+		if(nodes.isEmpty()) return hit;
+
+		QVector<int> stack;
+		stack.append(0);
+		while(!stack.isEmpty()) {
+			const int index=stack.takeLast();
+			const Node& n=nodes.at(index);
+			if(!hitsBox(n.box,o,inv,nearest)) continue;
+			if(n.count==0) {
+				stack.append(n.index);
+				stack.append(index+1);
+				continue;
+			}
+			for(auto i=n.index; i<n.index+n.count; ++i) {
+				const int f=order.at(i);
+				if(hitsFacet(facets.at(f),o,d,nearest))
+					hit=f;
+			}
+		}
+		return hit;
+	}
+};
+
+/* The range of the converted vertices, edges and facets of a
+ * polyhedron, and the tree used to pick its facets */
+struct Mesh {
+	int firstVertex;
+	int lastVertex;
+	int firstEdge;
+	int lastEdge;
+	int firstFacet;
+	int lastFacet;
+	FacetTree* facetTree;
+	GLuint displayList;
+};
+
+/* Shared geometry is only converted once and drawn at each of the
+ * places it is instanced */
+struct Placement {
+	int mesh;
+	QMatrix4x4 matrix;
+	CGAL::AffTransformation3 transform;
+};
+
 class NefConverter
 {
 	using SNC_structure=CGAL::NefPolyhedron3::SNC_structure;
@@ -186,6 +392,7 @@ class NefConverter
 		const float ny=static_cast<float>(CGAL::to_double(n.y()));
 		const float nz=static_cast<float>(CGAL::to_double(n.z()));
 		g.setNormal(nx,ny,nz);
+		g.setPlane(f->plane());
 		g.setMark(f->mark());
 		renderer.appendFacet(g);
 	}
@@ -215,39 +422,12 @@ public:
 
 };
 
-class DisplayList
-{
-	Q_DISABLE_COPY_MOVE(DisplayList)
-
-	QOpenGLFunctions_1_0& functions;
-	GLuint listId;
-	GLsizei range;
-
-public:
-	DisplayList(QOpenGLFunctions_1_0& f,GLsizei r) :
-		functions(f),
-		range(r)
-	{
-		listId=functions.glGenLists(range);
-	}
-
-	~DisplayList()
-	{
-		functions.glDeleteLists(listId,range);
-	}
-
-	GLuint getId(GLuint i) const
-	{
-		CGAL_assertion((GLsizei)i<range);
-		return listId+i;
-	}
-};
-
 CGALRenderer::CGALRenderer(Reporter& r,Primitive& pr) :
 	reporter(r),
 	primitive(pr),
 	simpleRenderer(pr),
-	displayList(nullptr),
+	filledMeshes(0),
+	compiling(false),
 	vertexSize(0.0F),
 	edgeSize(0.0F)
 {
@@ -257,15 +437,58 @@ CGALRenderer::CGALRenderer(Reporter& r,Primitive& pr) :
 
 CGALRenderer::~CGALRenderer()
 {
-	delete displayList;
+	deleteDisplayLists();
+	for(const auto& m: std::as_const(meshes))
+		delete m.facetTree;
+}
+
+static QMatrix4x4 toMatrix(const CGAL::AffTransformation3& t)
+{
+	QMatrix4x4 m;
+	for(auto i=0; i<3; ++i)
+		for(auto j=0; j<4; ++j)
+			m(i,j)=static_cast<float>(CGAL::to_double(t.m(i,j)));
+	return m;
+}
+
+void CGALRenderer::append(const QList<Primitive*>& children)
+{
+	for(Primitive* c: children)
+		descendChildren(*c);
 }
 
 void CGALRenderer::descendChildren(Primitive& p)
 {
+	auto convert=[this](const CGAL::NefPolyhedron3& n) {
+		Mesh m{};
+		m.firstVertex=vertices.size();
+		m.firstEdge=edges.size();
+		m.firstFacet=facets.size();
+		NefConverter c(*this);
+		c.convert(n);
+		m.lastVertex=vertices.size();
+		m.lastEdge=edges.size();
+		m.lastFacet=facets.size();
+		meshes.append(m);
+		return static_cast<int>(meshes.size()-1);
+	};
+
 	auto* pr=dynamic_cast<CGALPrimitive*>(&p);
 	if(pr) {
-		NefConverter c(*this);
-		c.convert(pr->getNefPolyhedron());
+		const auto& instances=pr->getInstances();
+		if(instances.isEmpty()) {
+			const int mesh=convert(pr->getNefPolyhedron());
+			placements.append(Placement{mesh,QMatrix4x4(),CGAL::AffTransformation3(CGAL::IDENTITY)});
+			return;
+		}
+		QHash<const CGALPrimitive::InstanceBase*,int> converted;
+		for(const auto& i: instances) {
+			const CGALPrimitive::InstanceBase* base=i.base.data();
+			auto it=converted.constFind(base);
+			const int mesh=it!=converted.constEnd()?it.value():convert(base->nefPolyhedron);
+			converted.insert(base,mesh);
+			placements.append(Placement{mesh,toMatrix(i.transform),i.transform});
+		}
 	} else {
 		for(Primitive* c: p.getChildren())
 			descendChildren(*c);
@@ -288,12 +511,15 @@ void CGALRenderer::loadPreferences()
 void CGALRenderer::preferencesUpdated()
 {
 	loadPreferences();
-	delete displayList;
-	displayList=nullptr;
+	deleteDisplayLists();
 }
 
 void CGALRenderer::setCompiling(bool value)
 {
+	/* A preview is told that it is compiling each time objects are
+	 * appended, which must not cost refilling all the display lists */
+	if(value==compiling) return;
+	compiling=value;
 	if(value) {
 		desaturate(markedVertexColor);
 		desaturate(vertexColor);
@@ -304,8 +530,7 @@ void CGALRenderer::setCompiling(bool value)
 	} else {
 		loadPreferences();
 	}
-	delete displayList;
-	displayList=nullptr;
+	deleteDisplayLists();
 }
 
 void CGALRenderer::desaturate(QColor& c)
@@ -313,11 +538,12 @@ void CGALRenderer::desaturate(QColor& c)
 	c=QColor::fromHsv(c.hue(),0,c.value());
 }
 
-void CGALRenderer::drawVertices(QOpenGLFunctions_1_0& f) const
+void CGALRenderer::drawVertices(QOpenGLFunctions_1_0& f,const Mesh& m) const
 {
 	const float p=getVertexSize();
 	if(p==0) return;
-	for(const auto& v : getVertices()) {
+	for(auto i=m.firstVertex; i<m.lastVertex; ++i) {
+		const auto& v=getVertices().at(i);
 		const QColor& c=getVertexColor(v.getMark());
 		f.glPointSize(p);
 		f.glColor3ub(c.red(),c.green(),c.blue());
@@ -327,11 +553,12 @@ void CGALRenderer::drawVertices(QOpenGLFunctions_1_0& f) const
 	}
 }
 
-void CGALRenderer::drawEdges(QOpenGLFunctions_1_0& f) const
+void CGALRenderer::drawEdges(QOpenGLFunctions_1_0& f,const Mesh& m) const
 {
 	const float w=getEdgeSize();
 	if(w==0) return;
-	for(const auto& e : getEdges()) {
+	for(auto i=m.firstEdge; i<m.lastEdge; ++i) {
+		const auto& e=getEdges().at(i);
 		auto p=e.source(),q=e.target();
 		const QColor& c=getEdgeColor(e.getMark());
 		f.glLineWidth(w);
@@ -384,7 +611,7 @@ inline void errorCallback(GLenum errorCode,GLvoid* data)
 	r.reportTesselationError(QString::fromLocal8Bit(gluErrorString(errorCode)));
 }
 
-void CGALRenderer::drawFacets(QOpenGLFunctions_1_0& f) const
+void CGALRenderer::drawFacets(QOpenGLFunctions_1_0& f,const Mesh& m) const
 {
 	GLUtesselator* t=gluNewTess();
 	using Callback=void (GLAPIENTRY*)(void);
@@ -395,7 +622,8 @@ void CGALRenderer::drawFacets(QOpenGLFunctions_1_0& f) const
 	gluTessCallback(t,GLU_TESS_ERROR_DATA,reinterpret_cast<Callback>(&errorCallback));
 	gluTessProperty(t,GLU_TESS_WINDING_RULE,GLU_TESS_WINDING_POSITIVE);
 
-	for(const auto& fc : getFacets()) {
+	for(auto i=m.firstFacet; i<m.lastFacet; ++i) {
+		const auto& fc=getFacets().at(i);
 		const QColor& c=getFacetColor(fc.getMark());
 		f.glColor3ub(c.red(),c.green(),c.blue());
 
@@ -449,36 +677,69 @@ const QList<FacetF>& CGALRenderer::getFacets() const
 	return facets;
 }
 
-void CGALRenderer::fillDisplayLists(QOpenGLFunctions_1_0& f)
+void CGALRenderer::fillDisplayLists(QOpenGLFunctions_1_0& f,const DisplayList& d,int first)
 {
-	f.glNewList(displayList->getId(0),GL_COMPILE);
-	drawVertices(f);
-	f.glEndList();
+	for(auto i=first; i<meshes.size(); ++i) {
+		Mesh& m=meshes[i];
+		m.displayList=d.getId(3*(i-first));
+		f.glNewList(m.displayList,GL_COMPILE);
+		drawVertices(f,m);
+		f.glEndList();
+
+		f.glNewList(m.displayList+1,GL_COMPILE);
+		drawEdges(f,m);
+		f.glEndList();
+
+		f.glNewList(m.displayList+2,GL_COMPILE);
+		drawFacets(f,m);
+		f.glEndList();
+	}
+}
 
-	f.glNewList(displayList->getId(1),GL_COMPILE);
-	drawEdges(f);
-	f.glEndList();
+void CGALRenderer::deleteDisplayLists()
+{
+	qDeleteAll(displayLists);
+	displayLists.clear();
+	filledMeshes=0;
+}
 
-	f.glNewList(displayList->getId(2),GL_COMPILE);
-	drawFacets(f);
-	f.glEndList();
+void CGALRenderer::callDisplayLists(QOpenGLFunctions_1_0& f,GLuint list) const
+{
+	for(const auto& p: placements) {
+		const GLuint id=meshes.at(p.mesh).displayList+list;
+		if(p.matrix.isIdentity()) {
+			f.glCallList(id);
+			continue;
+		}
+		f.glPushMatrix();
+		f.glMultMatrixf(p.matrix.constData());
+		f.glCallList(id);
+		f.glPopMatrix();
+	}
 }
 
 void CGALRenderer::paint(QOpenGLFunctions_1_0& f,bool skeleton,bool showedges)
 {
-	if(!displayList) {
-		displayList=new DisplayList(f,3);
-		fillDisplayLists(f);
+	/* Meshes appended since the last paint get a range of display lists
+	 * of their own, the lists of the others are kept */
+	if(filledMeshes<meshes.size()) {
+		auto* d=new DisplayList(f,3*(meshes.size()-filledMeshes));
+		displayLists.append(d);
+		fillDisplayLists(f,*d,filledMeshes);
+		filledMeshes=static_cast<int>(meshes.size());
 	}
+	/* Instances may be scaled so the normals need to be renormalised */
+	f.glEnable(GL_NORMALIZE);
 	if(!skeleton) {
-		f.glCallList(displayList->getId(2));
+		callDisplayLists(f,2);
 	}
 	if(skeleton||showedges) {
 		f.glDisable(GL_LIGHTING);
-		f.glCallList(displayList->getId(1));
-		f.glCallList(displayList->getId(0));
+		callDisplayLists(f,1);
+		callDisplayLists(f,0);
 		f.glEnable(GL_LIGHTING);
 	}
+	f.glDisable(GL_NORMALIZE);
 
 	simpleRenderer.paint(f,skeleton,showedges);
 
@@ -486,7 +747,35 @@ void CGALRenderer::paint(QOpenGLFunctions_1_0& f,bool skeleton,bool showedges)
 
 void CGALRenderer::locate(const QVector3D& s,const QVector3D& t)
 {
-	const Point& p=primitive.locate(Point(s.x(),s.y(),s.z()),Point(t.x(),t.y(),t.z()));
+	using Ray3=CGAL::Kernel3::Ray_3;
+
+	/* The facets do not change for the lifetime of the renderer so the
+	 * trees are built on the first pick and reused for all the others.
+	 * Each instance is picked by moving the ray into the frame of the
+	 * mesh it shares, which leaves the distances along it unchanged. */
+	double nearest=std::numeric_limits<double>::infinity();
+	int hit=-1;
+	const Placement* placement=nullptr;
+	for(const auto& pl: std::as_const(placements)) {
+		Mesh& m=meshes[pl.mesh];
+		if(!m.facetTree)
+			m.facetTree=new FacetTree(getFacets(),m.firstFacet,m.lastFacet);
+
+		const QMatrix4x4& inverse=pl.matrix.inverted();
+		const int i=m.facetTree->shoot(inverse.map(s),inverse.map(t),nearest);
+		if(i>=0) {
+			hit=i;
+			placement=&pl;
+		}
+	}
+
+	CGAL::Point3 p;
+	if(placement) {
+		const Ray3 ray(CGAL::Point3(s.x(),s.y(),s.z()),CGAL::Point3(t.x(),t.y(),t.z()));
+		const CGAL::Plane3& plane=getFacets().at(hit).getPlane().transform(placement->transform);
+		auto o=CGAL::intersection(plane,ray);
+		CGAL::assign(p,o);
+	}
 	reporter.reportMessage(to_string(p));
 }
 
@@ -28,6 +28,8 @@
 class PointF;
 class SegmentF;
 class FacetF;
+struct Mesh;
+struct Placement;
 
 class CGALRenderer : public Renderer
 {
@@ -39,12 +41,19 @@ public:
 	void locate(const QVector3D&,const QVector3D&) override;
 	void preferencesUpdated() override;
 	void setCompiling(bool) override;
+	/**
+	 * @brief Append objects to those being rendered, only the objects
+	 * given are converted and given display lists.
+	 */
+	void append(const QList<Primitive*>&);
 
 private:
-	void fillDisplayLists(QOpenGLFunctions_1_0&);
-	void drawVertices(QOpenGLFunctions_1_0&) const;
-	void drawEdges(QOpenGLFunctions_1_0&) const;
-	void drawFacets(QOpenGLFunctions_1_0&) const;
+	void fillDisplayLists(QOpenGLFunctions_1_0&,const class DisplayList&,int);
+	void deleteDisplayLists();
+	void callDisplayLists(QOpenGLFunctions_1_0&,GLuint) const;
+	void drawVertices(QOpenGLFunctions_1_0&,const Mesh&) const;
+	void drawEdges(QOpenGLFunctions_1_0&,const Mesh&) const;
+	void drawFacets(QOpenGLFunctions_1_0&,const Mesh&) const;
 	friend class NefConverter;
 	void appendVertex(const PointF&);
 	void appendEdge(const SegmentF&);
@@ -64,7 +73,9 @@ private:
 	Reporter& reporter;
 	Primitive& primitive;
 	SimpleRenderer simpleRenderer;
-	class DisplayList* displayList;
+	QList<class DisplayList*> displayLists;
+	int filledMeshes;
+	bool compiling;
 	float vertexSize;
 	float edgeSize;
 	QColor markedVertexColor;
@@ -76,6 +87,8 @@ private:
 	QList<PointF> vertices;
 	QList<SegmentF> edges;
 	QList<FacetF> facets;
+	QList<Mesh> meshes;
+	QList<Placement> placements;
 };
 
 #endif // CGALRENDERER_H
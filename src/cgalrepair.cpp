@@ -0,0 +1,146 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef USE_CGAL
+#include "cgalrepair.h"
+
+#include "cgalsanitizer.h"
+#include <CGAL/Polygon_mesh_processing/orient_polygon_soup.h>
+#include <CGAL/Polygon_mesh_processing/polygon_soup_to_polygon_mesh.h>
+#if CGAL_VERSION_NR >= CGAL_VERSION_NUMBER(5,1,0)
+#include <CGAL/Polygon_mesh_processing/repair_polygon_soup.h>
+#endif
+#include <CGAL/Polygon_mesh_processing/stitch_borders.h>
+#include <CGAL/Polygon_mesh_processing/triangulate_faces.h>
+#include <CGAL/Polygon_mesh_processing/triangulate_hole.h>
+#include <CGAL/boost/graph/graph_traits_Polyhedron_3.h>
+#include <CGAL/boost/graph/helpers.h>
+#include <QSet>
+#include <iterator>
+
+namespace PMP = CGAL::Polygon_mesh_processing;
+
+CGALRepair::CGALRepair(const Points& p,const Polygons& f) :
+	points(p),
+	polygons(f),
+	holeFilling(false),
+	mergedPoints(0),
+	removedPolygons(0),
+	removedEdges(0),
+	stitchedEdges(0),
+	filledHoles(0)
+{
+}
+
+void CGALRepair::setFillHoles(bool f)
+{
+	holeFilling=f;
+}
+
+bool CGALRepair::repair(CGAL::Polyhedron3& poly)
+{
+	const std::size_t pointCount=points.size();
+	const std::size_t polygonCount=polygons.size();
+
+#if CGAL_VERSION_NR >= CGAL_VERSION_NUMBER(5,1,0)
+	PMP::repair_polygon_soup(points,polygons);
+#endif
+	PMP::orient_polygon_soup(points,polygons);
+
+	/* Orienting may duplicate non manifold vertices so only count the
+	 * net change */
+	if(points.size()<pointCount)
+		mergedPoints=pointCount-points.size();
+	removedPolygons=polygonCount-polygons.size();
+
+	if(polygons.empty()||!PMP::is_polygon_soup_a_polygon_mesh(polygons))
+		return false;
+
+	PMP::polygon_soup_to_polygon_mesh(points,polygons,poly);
+
+	const std::size_t borders=countBorderEdges(poly);
+	PMP::stitch_borders(poly);
+	stitchedEdges=(borders-countBorderEdges(poly))/2;
+
+	/* Filling holes would close surfaces that are meant to be open, so
+	 * without it a mesh that is still open after stitching is left as is */
+	if(holeFilling)
+		fillHoles(poly);
+	else if(!CGAL::is_closed(poly))
+		return false;
+
+	if(!PMP::triangulate_faces(poly))
+		return false;
+
+	if(!poly.is_valid()||!CGAL::is_closed(poly))
+		return false;
+
+	CGALSanitizer s(poly);
+	if(!s.sanitize())
+		return false;
+	removedPolygons+=s.getRemovedTriangles();
+	removedEdges=s.getRemovedEdges();
+
+	return true;
+}
+
+std::size_t CGALRepair::countBorderEdges(const CGAL::Polyhedron3& poly)
+{
+	std::size_t n=0;
+	for(auto h=poly.halfedges_begin(); h!=poly.halfedges_end(); ++h)
+		if(h->is_border())
+			++n;
+	return n;
+}
+
+void CGALRepair::fillHoles(CGAL::Polyhedron3& poly)
+{
+	/* Collect one halfedge of each hole first, filling a hole only adds
+	 * facets to that hole so the others remain valid */
+	using HalfedgeHandle = CGAL::Polyhedron3::Halfedge_handle;
+	std::vector<HalfedgeHandle> holes;
+	QSet<const void*> visited;
+	for(auto h=poly.halfedges_begin(); h!=poly.halfedges_end(); ++h) {
+		if(!h->is_border()||visited.contains(&*h)) continue;
+		holes.push_back(h);
+		HalfedgeHandle c=h;
+		do {
+			visited.insert(&*c);
+			c=c->next();
+		} while(c!=h);
+	}
+
+	for(const auto& h: holes) {
+		std::vector<CGAL::Polyhedron3::Facet_handle> facets;
+		PMP::triangulate_hole(poly,h,std::back_inserter(facets));
+		if(!facets.empty())
+			++filledHoles;
+	}
+}
+
+bool CGALRepair::hasRepairs() const
+{
+	return mergedPoints||removedPolygons||removedEdges||stitchedEdges||filledHoles;
+}
+
+QString CGALRepair::getSummary() const
+{
+	return tr("Repaired mesh: merged %1 vertices, removed %2 polygons, removed %3 zero length edges, stitched %4 edges, filled %5 holes")
+		.arg(mergedPoints).arg(removedPolygons).arg(removedEdges).arg(stitchedEdges).arg(filledHoles);
+}
+
+#endif
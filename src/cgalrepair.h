@@ -0,0 +1,66 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef USE_CGAL
+#ifndef CGALREPAIR_H
+#define CGALREPAIR_H
+
+#include "cgal.h"
+#include <CGAL/Polyhedron_3.h>
+#include <QCoreApplication>
+#include <vector>
+
+namespace CGAL
+{
+using Polyhedron3 = Polyhedron_3<Kernel3>;
+} // namespace CGAL
+
+/**
+ * @brief Turns a polygon soup into a closed triangulated polyhedron by
+ * merging duplicate vertices, removing degenerate polygons, fixing the
+ * orientation and stitching borders. Holes are only filled on request.
+ * The repair works on its own copy of the soup so the original can still
+ * be used when the repair fails.
+ */
+class CGALRepair
+{
+	Q_DECLARE_TR_FUNCTIONS(CGALRepair)
+public:
+	using Points = std::vector<CGAL::Point3>;
+	using Polygons = std::vector<std::vector<std::size_t>>;
+
+	CGALRepair(const Points&,const Polygons&);
+	void setFillHoles(bool);
+	bool repair(CGAL::Polyhedron3&);
+	bool hasRepairs() const;
+	QString getSummary() const;
+private:
+	void fillHoles(CGAL::Polyhedron3&);
+	static std::size_t countBorderEdges(const CGAL::Polyhedron3&);
+
+	Points points;
+	Polygons polygons;
+	bool holeFilling;
+	std::size_t mergedPoints;
+	std::size_t removedPolygons;
+	std::size_t removedEdges;
+	std::size_t stitchedEdges;
+	std::size_t filledHoles;
+};
+
+#endif // CGALREPAIR_H
+#endif
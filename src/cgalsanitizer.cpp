@@ -18,12 +18,38 @@
 #ifdef USE_CGAL
 #include "cgalsanitizer.h"
 
+#include <CGAL/box_intersection_d.h>
 #include <QtGlobal>
+#include <cstdlib>
+#include <vector>
 
 CGALSanitizer::CGALSanitizer(CGAL::Polyhedron3& p) :
-	polyhedron(p)
+	polyhedron(p),
+	removedEdges(0),
+	removedTriangles(0)
 {}
 
+int CGALSanitizer::getRemovedEdges() const
+{
+	return removedEdges;
+}
+
+int CGALSanitizer::getRemovedTriangles() const
+{
+	return removedTriangles;
+}
+
+bool CGALSanitizer::hasRepairs() const
+{
+	return removedEdges||removedTriangles;
+}
+
+QString CGALSanitizer::getSummary() const
+{
+	return tr("Sanitized mesh: removed %1 zero length edges, removed %2 zero area triangles")
+		.arg(removedEdges).arg(removedTriangles);
+}
+
 bool CGALSanitizer::sanitize()
 {
 	fixZeroEdges();
@@ -56,33 +82,40 @@ bool CGALSanitizer::allEdgesSimple()
 	return true;
 }
 
-static bool connected(const CGAL::HalfedgeConstHandle& h1,const CGAL::HalfedgeConstHandle& h2)
-{
-	return(h1==h2||h1->next()==h2||h2->next()==h1||h1->prev()==h2||h2->prev()==h1);
-}
-
-static bool do_intersect(const CGAL::HalfedgeConstHandle& h1,const CGAL::HalfedgeConstHandle& h2)
+static bool facetIntersecting(const CGAL::Polyhedron3::Facet_const_handle& f)
 {
 	using Segment3 = CGAL::Segment_3<CGAL::Kernel3>;
-	const Segment3 s1(h1->vertex()->point(),h1->opposite()->vertex()->point());
-	const Segment3 s2(h2->vertex()->point(),h2->opposite()->vertex()->point());
-	return CGAL::do_intersect(s1,s2);
-}
-
-static bool facetIntersecting(const CGAL::FacetIterator& f)
-{
-	auto b=f->facet_begin(),e(b),o(b);
+	using Box = CGAL::Box_intersection_d::Box_with_info_d<double,3,int>;
+
+	/* Rather than testing every pair of edges exactly, only test the
+	 * pairs whose interval boxes overlap, and skip the neighbours which
+	 * always share a vertex */
+	std::vector<Segment3> segments;
+	std::vector<Box> boxes;
+	segments.reserve(f->facet_degree());
+	boxes.reserve(f->facet_degree());
+	auto b=f->facet_begin(),e(b);
 	CGAL_For_all(b,e) {
-		CGAL_For_all(o,e) {
-			if(connected(b,o)) continue;
-			if(do_intersect(b,o))
-				return true;
-		}
+		const Segment3 s(b->opposite()->vertex()->point(),b->vertex()->point());
+		boxes.emplace_back(s.bbox(),static_cast<int>(segments.size()));
+		segments.push_back(s);
 	}
-	return false;
+
+	const int n=static_cast<int>(segments.size());
+	bool intersecting=false;
+	CGAL::box_self_intersection_d(boxes.begin(),boxes.end(),[&](const Box& a,const Box& c) {
+		if(intersecting) return;
+		const int i=a.info();
+		const int j=c.info();
+		const int d=std::abs(i-j);
+		if(d==1||d==n-1) return;
+		if(CGAL::do_intersect(segments.at(i),segments.at(j)))
+			intersecting=true;
+	});
+	return intersecting;
 }
 
-static bool facetNoncoplanar(const CGAL::FacetIterator& f)
+static bool facetNoncoplanar(const CGAL::Polyhedron3::Facet_const_handle& f)
 {
 	auto b=f->facet_begin(),e(b);
 	CGAL::Point3 p[4];
@@ -107,11 +140,12 @@ static bool facetNoncoplanar(const CGAL::FacetIterator& f)
 
 bool CGALSanitizer::allFacetsSimple()
 {
+	/* The facets share their lazily evaluated points, which are not safe
+	 * to evaluate from several threads, so they are checked in turn. The
+	 * cheaper coplanar test rules out a facet first */
 	for(auto f=polyhedron.facets_begin(); f!=polyhedron.facets_end(); ++f) {
 		if(f->facet_degree()<=3) continue;
-		if(facetIntersecting(f))
-			return false;
-		if(facetNoncoplanar(f))
+		if(facetNoncoplanar(f)||facetIntersecting(f))
 			return false;
 	}
 	return true;
@@ -134,6 +168,7 @@ void CGALSanitizer::fixZeroTriangles()
 			} else {
 				removeLongestEdge(h1,h2,h3);
 			}
+			++removedTriangles;
 		}
 	}
 }
@@ -162,13 +197,15 @@ void CGALSanitizer::removeLongestEdge(const CGAL::HalfedgeHandle& h1,const CGAL:
 		polyhedron.join_facet(h3);
 }
 
-void CGALSanitizer::removeShortEdge(const CGAL::HalfedgeHandle& h1)
+bool CGALSanitizer::removeShortEdge(const CGAL::HalfedgeHandle& h1)
 {
 	// Determine the number of edges surrounding the vertex. e.g. \|/ or |/
 	auto edges=h1->vertex_degree();
 	if(edges<3) {
 		polyhedron.erase_facet(h1);
-	} else if(edges==3) {
+		return true;
+	}
+	if(edges==3) {
 		CGAL::HalfedgeHandle h2(h1->next());
 		if(hasLength(h2))
 			polyhedron.join_facet(h2);
@@ -182,15 +219,27 @@ void CGALSanitizer::removeShortEdge(const CGAL::HalfedgeHandle& h1)
 			polyhedron.join_facet(h3);
 		polyhedron.join_vertex(h1);
 	}
+	return false;
 }
 
 bool CGALSanitizer::removeShortEdges()
 {
-	for(auto h=polyhedron.halfedges_begin(); h!=polyhedron.halfedges_end(); ++h) {
-		if(!hasLength(h)) {
-			removeShortEdge(h);
+	/* Visit each edge once rather than both of its halfedges, and use
+	 * point equality which is filtered and much cheaper than computing
+	 * the exact squared length */
+	std::vector<CGAL::HalfedgeHandle> shortEdges;
+	for(auto h=polyhedron.edges_begin(); h!=polyhedron.edges_end(); ++h) {
+		if(h->vertex()->point()==h->opposite()->vertex()->point())
+			shortEdges.push_back(h);
+	}
+
+	/* Collapsing an edge only removes that edge and edges of non zero
+	 * length, so the rest of the worklist stays valid. Erasing a facet
+	 * can remove other short edges, so the edges are collected again */
+	for(const auto& h: shortEdges) {
+		++removedEdges;
+		if(removeShortEdge(h))
 			return true;
-		}
 	}
 	return false;
 }
@@ -21,6 +21,7 @@
 
 #include "cgal.h"
 #include <CGAL/Polyhedron_3.h>
+#include <QCoreApplication>
 
 namespace CGAL
 {
@@ -33,19 +34,26 @@ using FacetIterator = CGAL::Polyhedron3::Facet_iterator;
 
 class CGALSanitizer
 {
+	Q_DECLARE_TR_FUNCTIONS(CGALSanitizer)
 public:
 	CGALSanitizer(CGAL::Polyhedron3&);
 	bool sanitize();
+	int getRemovedEdges() const;
+	int getRemovedTriangles() const;
+	bool hasRepairs() const;
+	QString getSummary() const;
 private:
 	void fixZeroTriangles();
 	void fixZeroEdges();
 	bool allEdgesSimple();
 	bool allFacetsSimple();
 	void removeLongestEdge(const CGAL::HalfedgeHandle&,const CGAL::HalfedgeHandle&,const CGAL::HalfedgeHandle&);
-	void removeShortEdge(const CGAL::HalfedgeHandle&);
+	bool removeShortEdge(const CGAL::HalfedgeHandle&);
 	bool removeShortEdges();
 
 	CGAL::Polyhedron3& polyhedron;
+	int removedEdges;
+	int removedTriangles;
 };
 
 #endif // CGALSANITIZER_H
@@ -20,21 +20,117 @@
 #include "cgalvolume.h"
 #include "decimal.h"
 #include "point.h"
+#include "rmath.h"
+#include <CGAL/bounding_box.h>
 
 CGALVolume::CGALVolume() :
 	bounds(CGAL::Cuboid3()),
 	size(0),
-	centroid(CGAL::Point3(0.0,0.0,0.0))
+	centroid(CGAL::Point3(0.0,0.0,0.0)),
+	area(0)
 {
 }
 
 CGALVolume::CGALVolume(const CGAL::Cuboid3& b,const CGAL::Scalar& s,const CGAL::Point3& c) :
 	bounds(b),
 	size(s),
-	centroid(c)
+	centroid(c),
+	area(0)
 {
 }
 
+/* Volume, first and second moments scaled by 6, 24 and 120 respectively
+ * so that the per triangle terms need no division */
+struct CGALVolume::Moments {
+	CGAL::Scalar volume;
+	CGAL::Scalar x,y,z;
+	CGAL::Scalar xx,yy,zz,xy,yz,zx;
+	CGAL::Scalar area;
+};
+
+CGALVolume::Moments CGALVolume::getMoments(const CGAL::Triangle3& t,bool calcMass)
+{
+	Moments m;
+	const CGAL::Vector3 a=t[0]-CGAL::ORIGIN;
+	const CGAL::Vector3 b=t[1]-CGAL::ORIGIN;
+	const CGAL::Vector3 c=t[2]-CGAL::ORIGIN;
+	const CGAL::Scalar d=a*CGAL::cross_product(b,c);
+	m.volume=d;
+	if(!calcMass)
+		return m;
+
+	const CGAL::Vector3 s=a+b+c;
+	m.x=d*s.x();
+	m.y=d*s.y();
+	m.z=d*s.z();
+	m.xx=d*(a.x()*a.x()+b.x()*b.x()+c.x()*c.x()+s.x()*s.x());
+	m.yy=d*(a.y()*a.y()+b.y()*b.y()+c.y()*c.y()+s.y()*s.y());
+	m.zz=d*(a.z()*a.z()+b.z()*b.z()+c.z()*c.z()+s.z()*s.z());
+	m.xy=d*(a.x()*a.y()+b.x()*b.y()+c.x()*c.y()+s.x()*s.y());
+	m.yz=d*(a.y()*a.z()+b.y()*b.z()+c.y()*c.z()+s.y()*s.z());
+	m.zx=d*(a.z()*a.x()+b.z()*b.x()+c.z()*c.x()+s.z()*s.x());
+	m.area=r_sqrt(t.squared_area());
+	return m;
+}
+
+void CGALVolume::addMoments(Moments& r,const Moments& m)
+{
+	r.volume+=m.volume;
+	r.x+=m.x;
+	r.y+=m.y;
+	r.z+=m.z;
+	r.xx+=m.xx;
+	r.yy+=m.yy;
+	r.zz+=m.zz;
+	r.xy+=m.xy;
+	r.yz+=m.yz;
+	r.zx+=m.zx;
+	r.area+=m.area;
+}
+
+CGALVolume CGALVolume::fromTriangles(const QList<CGAL::Triangle3>& triangles,bool calcMass)
+{
+	QList<CGAL::Point3> points;
+	for(const auto& t: triangles)
+		for(auto i=0; i<3; ++i)
+			points.append(t[i]);
+	const CGAL::Cuboid3& b=CGAL::bounding_box(points.begin(),points.end());
+
+	/* The triangles share their vertices, so the moments are summed in
+	 * turn rather than on the thread pool */
+	Moments m;
+	for(const auto& t: triangles)
+		addMoments(m,getMoments(t,calcMass));
+
+	const CGAL::Scalar& v=m.volume/6.0;
+	if(!calcMass || v==0.0) {
+		const CGAL::Scalar& cx=(b.xmin()+b.xmax())/2.0;
+		const CGAL::Scalar& cy=(b.ymin()+b.ymax())/2.0;
+		const CGAL::Scalar& cz=(b.zmin()+b.zmax())/2.0;
+		return CGALVolume(b,v,CGAL::Point3(cx,cy,cz));
+	}
+
+	const CGAL::Scalar& cx=m.x/(m.volume*4.0);
+	const CGAL::Scalar& cy=m.y/(m.volume*4.0);
+	const CGAL::Scalar& cz=m.z/(m.volume*4.0);
+	CGALVolume r(b,v,CGAL::Point3(cx,cy,cz));
+	r.area=m.area/2.0;
+
+	/* Inertia tensor about the centroid assuming unit density */
+	const CGAL::Scalar& sxx=m.xx/120.0-v*cx*cx;
+	const CGAL::Scalar& syy=m.yy/120.0-v*cy*cy;
+	const CGAL::Scalar& szz=m.zz/120.0-v*cz*cz;
+	const CGAL::Scalar& sxy=m.xy/120.0-v*cx*cy;
+	const CGAL::Scalar& syz=m.yz/120.0-v*cy*cz;
+	const CGAL::Scalar& szx=m.zx/120.0-v*cz*cx;
+	r.inertia={
+		syy+szz,-sxy,-szx,
+		-sxy,sxx+szz,-syz,
+		-szx,-syz,sxx+syy
+	};
+	return r;
+}
+
 const CGAL::Scalar& CGALVolume::getSize() const
 {
 	return size;
@@ -50,6 +146,16 @@ const CGAL::Cuboid3& CGALVolume::getBounds() const
 	return bounds;
 }
 
+const CGAL::Scalar& CGALVolume::getArea() const
+{
+	return area;
+}
+
+const QList<CGAL::Scalar>& CGALVolume::getInertia() const
+{
+	return inertia;
+}
+
 QString CGALVolume::getSizeString() const
 {
 	return to_string(size);
@@ -60,4 +166,22 @@ QString CGALVolume::getCenterString() const
 	return to_string(centroid);
 }
 
+QString CGALVolume::getAreaString() const
+{
+	return to_string(area);
+}
+
+QString CGALVolume::getInertiaString() const
+{
+	QString s="[";
+	for(auto i=0; i<inertia.size(); i+=3) {
+		if(i>0)
+			s.append(",");
+		s.append(QString("[%1,%2,%3]").arg(to_string(inertia.at(i)),
+			to_string(inertia.at(i+1)),to_string(inertia.at(i+2))));
+	}
+	s.append("]");
+	return s;
+}
+
 #endif
@@ -20,6 +20,7 @@
 #define CGALVOLUME_H
 
 #include "cgal.h"
+#include <QList>
 #include <QString>
 
 class CGALVolume
@@ -27,15 +28,31 @@ class CGALVolume
 public:
 	CGALVolume();
 	CGALVolume(const CGAL::Cuboid3&,const CGAL::Scalar&,const CGAL::Point3&);
+	/**
+	 * @brief Calculate the mass properties of a closed surface from its
+	 * triangles, using the divergence theorem to sum the signed tetrahedra
+	 * that each triangle forms with the origin.
+	 */
+	static CGALVolume fromTriangles(const QList<CGAL::Triangle3>&,bool calcMass);
 	const CGAL::Point3& getCenter() const;
 	const CGAL::Scalar& getSize() const;
 	const CGAL::Cuboid3& getBounds() const;
+	const CGAL::Scalar& getArea() const;
+	const QList<CGAL::Scalar>& getInertia() const;
 	QString getSizeString() const;
 	QString getCenterString() const;
+	QString getAreaString() const;
+	QString getInertiaString() const;
 private:
+	struct Moments;
+	static Moments getMoments(const CGAL::Triangle3&,bool);
+	static void addMoments(Moments&,const Moments&);
+
 	CGAL::Cuboid3 bounds;
 	CGAL::Scalar size;
 	CGAL::Point3 centroid;
+	CGAL::Scalar area;
+	QList<CGAL::Scalar> inertia;
 };
 
 #endif // CGALVOLUME_H
@@ -17,7 +17,7 @@
  */
 
 #include "decimal.h"
-#include "preferences.h"
+#include "evaluationsettings.h"
 #include "rmath.h"
 #ifdef USE_CGAL
 #if MPFR_VERSION < MPFR_VERSION_NUM(4,1,0)
@@ -57,7 +57,7 @@ decimal to_decimal(const QString& str,bool* ok)
 
 QString to_string(const decimal& d)
 {
-	auto& p=Preferences::getInstance();
+	const auto& p=EvaluationSettings::current();
 	const NumberFormats format=p.getNumberFormat();
 
 	if(format!=NumberFormats::Scientific && d==0.0)
@@ -190,9 +190,17 @@ mpq_srcptr to_mpq(const decimal& d)
 #endif
 }
 
+void init_mpfr(mpfr_t& m)
+{
+	/* The default precision of mpfr is shared by the whole process, so
+	 * each value takes the precision of the evaluation it belongs to */
+	mpfr_init2(m,EvaluationSettings::current().getSignificandBits());
+}
+
 void to_mpfr(mpfr_t& m, const decimal& d)
 {
-	mpfr_init_set_q(m,to_mpq(d),MPFR_RNDN);
+	init_mpfr(m);
+	mpfr_set_q(m,to_mpq(d),MPFR_RNDN);
 }
 
 decimal to_decimal(mpfr_t& m)
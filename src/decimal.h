@@ -61,6 +61,7 @@ decimal get_unit(QString&);
 
 #ifdef USE_CGAL
 mpq_srcptr to_mpq(const decimal&);
+void init_mpfr(mpfr_t&);
 void to_mpfr(mpfr_t&,const decimal&);
 decimal to_decimal(mpfr_t&);
 decimal to_decimal(mpq_t&);
@@ -0,0 +1,37 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "displaylist.h"
+
+DisplayList::DisplayList(QOpenGLFunctions_1_0& f,GLsizei r) :
+	functions(f),
+	range(r)
+{
+	listId=functions.glGenLists(range);
+}
+
+DisplayList::~DisplayList()
+{
+	functions.glDeleteLists(listId,range);
+}
+
+GLuint DisplayList::getId(GLuint i) const
+{
+	Q_ASSERT(static_cast<GLsizei>(i)<range);
+	return listId+i;
+}
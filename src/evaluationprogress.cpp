@@ -0,0 +1,80 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "evaluationprogress.h"
+
+static thread_local EvaluationProgress* active=nullptr;
+
+EvaluationProgress::EvaluationProgress(const Preview& p) :
+	cancelled(false),
+	previewer(p)
+{
+}
+
+void EvaluationProgress::reset()
+{
+	cancelled.store(false,std::memory_order_relaxed);
+}
+
+void EvaluationProgress::cancel()
+{
+	cancelled.store(true,std::memory_order_relaxed);
+}
+
+bool EvaluationProgress::isCancelled() const
+{
+	return cancelled.load(std::memory_order_relaxed);
+}
+
+void EvaluationProgress::check()
+{
+	if(active && active->isCancelled())
+		throw Cancelled();
+}
+
+void EvaluationProgress::preview(Primitive& p)
+{
+	if(active && active->previewer)
+		active->previewer(p);
+}
+
+EvaluationProgress* EvaluationProgress::current()
+{
+	return active;
+}
+
+EvaluationProgress::Scope::Scope(EvaluationProgress* p) :
+	previous(active)
+{
+	active=p;
+}
+
+EvaluationProgress::Scope::~Scope()
+{
+	active=previous;
+}
+
+void EvaluationProgress::Cancelled::raise() const
+{
+	throw *this;
+}
+
+EvaluationProgress::Cancelled* EvaluationProgress::Cancelled::clone() const
+{
+	return new Cancelled(*this);
+}
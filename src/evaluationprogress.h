@@ -0,0 +1,76 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EVALUATIONPROGRESS_H
+#define EVALUATIONPROGRESS_H
+
+#include <QException>
+#include <atomic>
+#include <functional>
+
+class Primitive;
+
+class EvaluationProgress
+{
+	Q_DISABLE_COPY_MOVE(EvaluationProgress)
+public:
+	using Preview=std::function<void(Primitive&)>;
+	explicit EvaluationProgress(const Preview&);
+	void reset();
+	void cancel();
+	bool isCancelled() const;
+
+	/**
+	 * @brief Throws Cancelled when the evaluation that is running on the
+	 * calling thread has been cancelled. Evaluators and primitives call
+	 * this between the steps of long computations.
+	 */
+	static void check();
+
+	/**
+	 * @brief Offers a finished top level object of the evaluation that is
+	 * running on the calling thread so that it can be shown while the rest
+	 * of the objects are still being computed.
+	 */
+	static void preview(Primitive&);
+	static EvaluationProgress* current();
+
+	class Scope
+	{
+		Q_DISABLE_COPY_MOVE(Scope)
+	public:
+		explicit Scope(EvaluationProgress*);
+		~Scope();
+	private:
+		EvaluationProgress* previous;
+	};
+
+	/* Derived from QException so that it is carried across the futures of
+	 * the concurrent evaluation */
+	class Cancelled : public QException
+	{
+	public:
+		void raise() const override;
+		Cancelled* clone() const override;
+	};
+private:
+	std::atomic<bool> cancelled;
+	Preview previewer;
+};
+
+#endif // EVALUATIONPROGRESS_H
@@ -0,0 +1,130 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "evaluationsettings.h"
+#include "importcache.h"
+#include "preferences.h"
+#include <QStringList>
+#include <atomic>
+
+static std::atomic<int> generation(0);
+static thread_local const EvaluationSettings* active=nullptr;
+
+EvaluationSettings::EvaluationSettings(bool preview)
+{
+	auto& p=Preferences::getInstance();
+	functionRounding=p.getFunctionRounding();
+	decimalPlaces=p.getDecimalPlaces();
+	significandBits=p.getSignificandBits();
+	numberFormat=p.getNumberFormat();
+	if(preview) {
+		fragmentLimit=p.getPreviewFragmentLimit();
+		fragmentScale=1.0;
+	} else {
+		fragmentLimit=0;
+		fragmentScale=p.getFragmentScale();
+	}
+}
+
+Rounding EvaluationSettings::getFunctionRounding() const
+{
+	return functionRounding;
+}
+
+int EvaluationSettings::getDecimalPlaces() const
+{
+	return decimalPlaces;
+}
+
+int EvaluationSettings::getSignificandBits() const
+{
+	return significandBits;
+}
+
+NumberFormats EvaluationSettings::getNumberFormat() const
+{
+	return numberFormat;
+}
+
+int EvaluationSettings::getFragmentLimit() const
+{
+	return fragmentLimit;
+}
+
+float EvaluationSettings::getFragmentScale() const
+{
+	return fragmentScale;
+}
+
+QString EvaluationSettings::getLevelOfDetail() const
+{
+	return QString("%1:%2").arg(fragmentLimit).arg(fragmentScale);
+}
+
+EvaluationSettings EvaluationSettings::withNumberFormat(NumberFormats format) const
+{
+	EvaluationSettings s(*this);
+	s.numberFormat=format;
+	return s;
+}
+
+const EvaluationSettings& EvaluationSettings::current()
+{
+	if(active)
+		return *active;
+
+	/* Threads that are not within a scope, such as those of the geometry
+	 * evaluator's pool, keep their own snapshot which only needs to be
+	 * taken again once the preferences have changed */
+	static thread_local int snapshotGeneration=generation.load(std::memory_order_acquire);
+	static thread_local EvaluationSettings snapshot;
+	const int g=generation.load(std::memory_order_acquire);
+	if(g!=snapshotGeneration) {
+		snapshot=EvaluationSettings();
+		snapshotGeneration=g;
+	}
+	return snapshot;
+}
+
+bool EvaluationSettings::isSetting(const QString& key)
+{
+	static const QStringList keys {
+		"FunctionRounding","SignificandBits","NumberFormat",
+		"PreviewFragmentLimit","FragmentScale"
+	};
+	return keys.contains(key);
+}
+
+void EvaluationSettings::invalidate()
+{
+	generation.fetch_add(1,std::memory_order_release);
+	/* Imported scripts were evaluated with the previous settings, such as
+	 * the precision and rounding, so their results are stale */
+	ImportCache::getInstance().flushCaches();
+}
+
+EvaluationSettings::Scope::Scope(const EvaluationSettings& s) :
+	previous(active)
+{
+	active=&s;
+}
+
+EvaluationSettings::Scope::~Scope()
+{
+	active=previous;
+}
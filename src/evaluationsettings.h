@@ -0,0 +1,86 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EVALUATIONSETTINGS_H
+#define EVALUATIONSETTINGS_H
+
+#include "decimal.h"
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * @brief An immutable copy of the preferences which affect numeric
+ * results, so that the numeric functions never have to read the settings.
+ */
+class EvaluationSettings
+{
+public:
+	/**
+	 * @brief Take a copy of the preferences. A preview evaluation caps the
+	 * number of fragments, whereas a final one scales them.
+	 */
+	explicit EvaluationSettings(bool preview=false);
+	Rounding getFunctionRounding() const;
+	int getDecimalPlaces() const;
+	int getSignificandBits() const;
+	NumberFormats getNumberFormat() const;
+	int getFragmentLimit() const;
+	float getFragmentScale() const;
+	/**
+	 * @brief Describes the level of detail, so that caches of evaluated
+	 * geometry can tell apart results of a different level.
+	 */
+	QString getLevelOfDetail() const;
+	/**
+	 * @brief A copy of these settings that formats numbers differently,
+	 * such as in their exact rational form.
+	 */
+	EvaluationSettings withNumberFormat(NumberFormats) const;
+
+	/**
+	 * @brief The settings in effect on the calling thread. These are the
+	 * settings of the innermost Scope, or a snapshot of the preferences
+	 * that is refreshed whenever they change.
+	 */
+	static const EvaluationSettings& current();
+	static void invalidate();
+	/**
+	 * @brief Whether the preference with the given key is one of those
+	 * copied by the settings.
+	 */
+	static bool isSetting(const QString&);
+
+	class Scope
+	{
+		Q_DISABLE_COPY_MOVE(Scope)
+	public:
+		explicit Scope(const EvaluationSettings&);
+		~Scope();
+	private:
+		const EvaluationSettings* previous;
+	};
+private:
+	Rounding functionRounding;
+	int decimalPlaces;
+	int significandBits;
+	NumberFormats numberFormat;
+	int fragmentLimit;
+	float fragmentScale;
+};
+
+#endif // EVALUATIONSETTINGS_H
@@ -18,7 +18,9 @@
 
 #include "fragment.h"
 #include "context.h"
+#include "evaluationsettings.h"
 #include "numbervalue.h"
+#include <cmath>
 #include <contrib/fragments.h>
 
 #ifdef USE_CGAL
@@ -31,6 +33,12 @@ Fragment::Fragment(const Context& ctx) :
 	fragmentAngle(12.0),
 	fragmentError(0.0)
 {
+	/* Capture the level of detail here, since the fragment is kept by nodes
+	 * such as rotate_extrude and used later on the evaluator's threads */
+	const auto& s=EvaluationSettings::current();
+	fragmentLimit=s.getFragmentLimit();
+	fragmentScale=s.getFragmentScale();
+
 	NumberValue* fnVal=dynamic_cast<NumberValue*>(ctx.getArgumentSpecial("fn"));
 	if(fnVal)
 		fragmentNumber=fnVal->toInteger();
@@ -63,13 +71,23 @@ Fragment* Fragment::createFragment(const Context& ctx)
 #endif
 }
 
+int Fragment::getFragments(const decimal& r) const
+{
+	const int f=calculateFragments(r);
+	if(fragmentLimit>0 && f>fragmentLimit)
+		return std::max(fragmentLimit,3);
+	if(fragmentScale!=1.0)
+		return std::max(static_cast<int>(std::ceil(f*fragmentScale)),3);
+	return f;
+}
+
 #ifdef USE_CGAL
-int Fragment::getFragments(const decimal&) const
+int Fragment::calculateFragments(const decimal&) const
 {
 	throw;
 }
 #else
-int Fragment::getFragments(const decimal& r) const
+int Fragment::calculateFragments(const decimal& r) const
 {
 	return get_fragments_from_r(r,fragmentNumber,fragmentSize,fragmentAngle);
 }
@@ -30,14 +30,21 @@ public:
 	virtual ~Fragment()=default;
 	static Fragment* createFragment(const Context&);
 	static int getFragments(const Context&,const decimal&);
-	virtual int getFragments(const decimal&) const;
+	/**
+	 * @brief The number of fragments for the given radius, adjusted to the
+	 * level of detail of the evaluation that created the fragment.
+	 */
+	int getFragments(const decimal&) const;
 protected:
-	Fragment()=default;
 	explicit Fragment(const Context&);
+	virtual int calculateFragments(const decimal&) const;
 	int fragmentNumber;
 	decimal fragmentSize;
 	decimal fragmentAngle;
 	decimal fragmentError;
+private:
+	int fragmentLimit;
+	float fragmentScale;
 };
 
 #endif // FRAGMENT_H
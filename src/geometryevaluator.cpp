@@ -16,65 +16,154 @@
  *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "geometryevaluator.h"
+#include "evaluationprogress.h"
+#include "evaluationsettings.h"
 #include "polyhedron.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
 
 #ifdef USE_CGAL
 #include "cgalauxiliarybuilder.h"
 #include "cgalimport.h"
+#include "cgalinstancer.h"
 #include "cgalprimitive.h"
 #include <CGAL/exceptions.h>
 #endif
 
+/* Tracks the results of the children which are not yet reduced, so that
+ * they can be deleted when the evaluation is cancelled part way */
+class GeometryEvaluator::PartialResults
+{
+	Q_DISABLE_COPY_MOVE(PartialResults)
+public:
+	PartialResults() : reduced(nullptr) {}
+	void mapped(Primitive* p)
+	{
+		const QMutexLocker locker(&mutex);
+		if(p) pending.insert(p);
+	}
+	void reduce(Primitive* p,Primitive* c)
+	{
+		const QMutexLocker locker(&mutex);
+		pending.remove(c);
+		reduced=p;
+	}
+	void dispose()
+	{
+		const QMutexLocker locker(&mutex);
+		pending.remove(reduced);
+		qDeleteAll(pending);
+		pending.clear();
+		delete reduced;
+		reduced=nullptr;
+	}
+private:
+	QMutex mutex;
+	QSet<Primitive*> pending;
+	Primitive* reduced;
+};
+
 class GeometryEvaluator::MapFunctor
 {
 public:
-	MapFunctor(Reporter& r) : reporter(r) {}
+	MapFunctor(Reporter& r,CGALInstancer* i,EvaluationProgress* p,bool v,const Partial& pr) :
+		reporter(r),instancer(i),progress(p),preview(v),settings(EvaluationSettings::current()),partial(pr) {}
 	Primitive* operator()(Node* n)
 	{
-		GeometryEvaluator g(reporter);
+		/* Children are evaluated on the pool's threads, so carry over the
+		 * settings, progress and reporter of the thread that started the
+		 * evaluation */
+		const EvaluationSettings::Scope scope(settings);
+		const EvaluationProgress::Scope active(progress);
+		const Reporter::Scope reports(reporter);
+		EvaluationProgress::check();
+		GeometryEvaluator g(reporter,instancer);
 		n->accept(g);
-		return g.getResult();
+		Primitive* p=g.getResult();
+		partial->mapped(p);
+		if(preview && p)
+			EvaluationProgress::preview(*p);
+		return p;
 	}
 private:
 	Reporter& reporter;
+	CGALInstancer* instancer;
+	EvaluationProgress* progress;
+	bool preview;
+	EvaluationSettings settings;
+	Partial partial;
 };
 
 class GeometryEvaluator::ReduceFunctor
 {
 public:
-	explicit ReduceFunctor(Reporter& r,const ReduceFunction& f) :
-		reporter(r),function(f) {}
+	ReduceFunctor(Reporter& r,const ReduceFunction& f,EvaluationProgress* p,const Partial& pr) :
+		reporter(r),function(f),progress(p),partial(pr) {}
 	void operator()(Primitive*& p,Primitive* c)
 	{
+		const EvaluationProgress::Scope active(progress);
+		const Reporter::Scope reports(reporter);
 		try {
+			EvaluationProgress::check();
 			function(p,c);
+			partial->reduce(p,c);
+		} catch(const EvaluationProgress::Cancelled&) {
+			destroy(p,c);
+			throw;
 #ifdef USE_CGAL
 		} catch(const CGAL::Failure_exception& e) {
-			destroy(p);
-			destroy(c);
+			destroy(p,c);
 			reporter.reportException(QString::fromStdString(e.what()));
 #endif
 		} catch(...) {
-			destroy(p);
-			destroy(c);
+			destroy(p,c);
 			reporter.reportException();
 		}
 	}
 private:
-	static void destroy(Primitive*& p) { delete p; p=nullptr; }
+	void destroy(Primitive*& p,Primitive* c)
+	{
+		partial->reduce(nullptr,c);
+		delete p;
+		p=nullptr;
+		delete c;
+	}
 	Reporter& reporter;
 	ReduceFunction function;
+	EvaluationProgress* progress;
+	Partial partial;
 };
 
 GeometryEvaluator::GeometryEvaluator(Reporter& r) :
+	GeometryEvaluator(r,nullptr)
+{
+#ifdef USE_CGAL
+	/* The evaluators of all the children share the geometry placed by
+	 * identical transformations */
+	instancer=new CGALInstancer();
+	ownsInstancer=true;
+#endif
+	root=true;
+}
+
+GeometryEvaluator::GeometryEvaluator(Reporter& r,CGALInstancer* i) :
 	pool(new QThreadPool()),
-	reporter(r)
+	reporter(r),
+	instancer(i),
+	ownsInstancer(false),
+	progress(EvaluationProgress::current()),
+	root(false)
 {
 }
 
 GeometryEvaluator::~GeometryEvaluator()
 {
 	delete pool;
+#ifdef USE_CGAL
+	if(ownsInstancer)
+		delete instancer;
+#endif
 }
 
 Primitive* GeometryEvaluator::createPrimitive()
@@ -91,54 +180,92 @@ Primitive* GeometryEvaluator::noResult()
 	return nullptr;
 }
 
+QFuture<Primitive*> GeometryEvaluator::run(const Evaluate& evaluate)
+{
+	/* The evaluation runs on the pool's threads, so carry over the
+	 * progress and reporter of the thread that started it */
+	EvaluationProgress* p=progress;
+	Reporter* r=&reporter;
+	return QtConcurrent::run(pool,[evaluate,p,r]() {
+		const EvaluationProgress::Scope active(p);
+		const Reporter::Scope reports(*r);
+		EvaluationProgress::check();
+		return evaluate();
+	});
+}
+
 QFuture<Primitive*> GeometryEvaluator::reduceChildren(
-	const Node& n,const ReduceFunction& function,QtConcurrent::ReduceOptions options)
+	const Node& n,const ReduceFunction& function,QtConcurrent::ReduceOptions options,bool preview)
 {
 	const auto& children=n.getChildren();
-	const MapFunction& map=MapFunctor(reporter);
-	const ReduceFunction& reduce=ReduceFunctor(reporter,function);
+	partial.reset(new PartialResults());
+	const MapFunction& map=MapFunctor(reporter,instancer,progress,preview,partial);
+	const ReduceFunction& reduce=ReduceFunctor(reporter,function,progress,partial);
 	return QtConcurrent::mappedReduced<Primitive*>(pool,children,map,reduce,options);
 }
 
+Primitive* GeometryEvaluator::blockingReduceChildren(const Node& n,const ReduceFunction& function)
+{
+	const auto& children=n.getChildren();
+	const Partial p(new PartialResults());
+	const MapFunction& map=MapFunctor(reporter,instancer,progress,false,p);
+	Reporter* rep=&reporter;
+	const ReduceFunction& reduce=[function,p,rep](Primitive*& r,Primitive* c) {
+		const Reporter::Scope reports(*rep);
+		function(r,c);
+		p->reduce(r,c);
+	};
+	try {
+		return QtConcurrent::blockingMappedReduced<Primitive*>(pool,children,map,reduce,QtConcurrent::UnorderedReduce);
+	} catch(...) {
+		p->dispose();
+		throw;
+	}
+}
+
 // blocking because we can't apply operations until evaluated
 Primitive* GeometryEvaluator::unionChildren(const Node& n)
 {
-	const auto& children=n.getChildren();
-	const MapFunction& map=MapFunctor(reporter);
-	return QtConcurrent::blockingMappedReduced<Primitive*>(pool,children,map,
-	[](auto& p,auto c) {
+	return blockingReduceChildren(n,[](auto& p,auto c) {
 		p=p?p->join(c):c;
-	},QtConcurrent::UnorderedReduce);
+	});
 }
 
 Primitive* GeometryEvaluator::appendChildren(const Node& n)
 {
-	const auto& children=n.getChildren();
-	const MapFunction& map=MapFunctor(reporter);
-	return QtConcurrent::blockingMappedReduced<Primitive*>(pool,children,map,
-	[](auto& p,auto c) {
+	return blockingReduceChildren(n,[](auto& p,auto c) {
 		if(!p) p=createPrimitive();
 		p->appendChild(c);
-	},QtConcurrent::UnorderedReduce);
+	});
 }
 
 void GeometryEvaluator::visit(const PrimitiveNode& n)
 {
 	if(n.childCount()>0) {
-		result=reduceChildren(n,[&n](auto& p,auto c) {
-			if(!p) p=n.getPrimitive();
+		result=reduceChildren(n,[&n,this](auto& p,auto c) {
+			if(!p) p=getPrimitive(n);
 			p=p->join(c);
 		});
 	} else {
-		result=QtConcurrent::run(pool,[&n]() {
-			return n.getPrimitive();
+		result=run([&n,this]() {
+			return getPrimitive(n);
 		});
 	}
 }
 
+Primitive* GeometryEvaluator::getPrimitive(const PrimitiveNode& n)
+{
+	Primitive* p=n.getPrimitive();
+#ifdef USE_CGAL
+	auto* cp=dynamic_cast<CGALPrimitive*>(p);
+	if(cp) cp->repair(reporter);
+#endif
+	return p;
+}
+
 void GeometryEvaluator::visit(const TriangulateNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 		return p?p->triangulate():noResult();
 	});
@@ -146,7 +273,7 @@ void GeometryEvaluator::visit(const TriangulateNode& n)
 
 void GeometryEvaluator::visit(const MaterialNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		auto* p=unionChildren(n);
 		Primitive* ph=new Polyhedron();
 		ph->appendChild(p);
@@ -156,7 +283,7 @@ void GeometryEvaluator::visit(const MaterialNode& n)
 
 void GeometryEvaluator::visit(const DiscreteNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 		if(p) p->discrete(n.getPlaces());
 		return p;
@@ -165,16 +292,17 @@ void GeometryEvaluator::visit(const DiscreteNode& n)
 
 void GeometryEvaluator::visit(const UnionNode& n)
 {
+	/* The top level objects can be shown as soon as each is finished */
 	result=reduceChildren(n,[](auto& p,auto c) {
 		p=p?p->join(c):c;
-	},QtConcurrent::UnorderedReduce);
+	},QtConcurrent::UnorderedReduce,root);
 }
 
 void GeometryEvaluator::visit(const GroupNode& n)
 {
 	result=reduceChildren(n,[](auto& p,auto c) {
 		p=p?p->group(c):c;
-	},QtConcurrent::UnorderedReduce);
+	},QtConcurrent::UnorderedReduce,root);
 }
 
 void GeometryEvaluator::visit(const DifferenceNode& n)
@@ -239,7 +367,7 @@ Primitive* GeometryEvaluator::chainHull(const HullNode& n)
 
 void GeometryEvaluator::visit(const HullNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		if(n.getChain()) {
 			return chainHull(n);
 		} else {
@@ -251,7 +379,7 @@ void GeometryEvaluator::visit(const HullNode& n)
 
 void GeometryEvaluator::visit(const LinearExtrudeNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 		return p?p->linear_extrude(n.getHeight(),n.getAxis()):noResult();
 	});
@@ -259,7 +387,7 @@ void GeometryEvaluator::visit(const LinearExtrudeNode& n)
 
 void GeometryEvaluator::visit(const RotateExtrudeNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 		return p?p->rotate_extrude(n.getHeight(),n.getRadius(),n.getSweep(),n.getFragments(),n.getAxis()):noResult();
 	});
@@ -267,7 +395,7 @@ void GeometryEvaluator::visit(const RotateExtrudeNode& n)
 
 void GeometryEvaluator::visit(const BoundsNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 #ifdef USE_CGAL
 		CGALAuxiliaryBuilder b(reporter);
@@ -280,7 +408,7 @@ void GeometryEvaluator::visit(const BoundsNode& n)
 
 void GeometryEvaluator::visit(const SubDivisionNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 		return p?p->subdivide(n.getLevel()):noResult();
 	});
@@ -288,7 +416,7 @@ void GeometryEvaluator::visit(const SubDivisionNode& n)
 
 void GeometryEvaluator::visit(const NormalsNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 #ifdef USE_CGAL
 		CGALAuxiliaryBuilder b(reporter);
@@ -301,7 +429,7 @@ void GeometryEvaluator::visit(const NormalsNode& n)
 
 void GeometryEvaluator::visit(const SimplifyNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 		return p?p->simplify(n.getRatio()):noResult();
 	});
@@ -309,7 +437,7 @@ void GeometryEvaluator::visit(const SimplifyNode& n)
 
 void GeometryEvaluator::visit(const SolidNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 		return p?p->solidify():noResult();
 	});
@@ -317,7 +445,7 @@ void GeometryEvaluator::visit(const SolidNode& n)
 
 void GeometryEvaluator::visit(const ChildrenNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		//TODO: implement index based selection
 		return unionChildren(n);
 	});
@@ -325,7 +453,7 @@ void GeometryEvaluator::visit(const ChildrenNode& n)
 
 void GeometryEvaluator::visit(const OffsetNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 		return p?p->inset(n.getAmount()):noResult();
 	});
@@ -333,7 +461,7 @@ void GeometryEvaluator::visit(const OffsetNode& n)
 
 void GeometryEvaluator::visit(const BoundaryNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 		return p?p->boundary():noResult();
 	});
@@ -341,10 +469,10 @@ void GeometryEvaluator::visit(const BoundaryNode& n)
 
 void GeometryEvaluator::visit(const ImportNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 #ifdef USE_CGAL
 		const QFileInfo f(n.getImport());
-		const CGALImport i(f,reporter);
+		const CGALImport i(f,reporter,n.getFillHoles());
 		return i.import();
 #else
 		return noResult();
@@ -354,25 +482,42 @@ void GeometryEvaluator::visit(const ImportNode& n)
 
 void GeometryEvaluator::visit(const TransformationNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
-		Primitive* p=unionChildren(n);
-		if(!p) return noResult();
+	result=run([&n,this]() {
+		/* Nested transformations are composed so that the exact geometry
+		 * of the innermost children is only transformed once */
+		TransformMatrix m;
+		bool found;
+		const TransformationNode& inner=n.compose(m,found);
 #ifdef USE_CGAL
 		using Axis = TransformationNode::Axis;
-		const Axis axis=n.getDatumAxis();
+		const Axis axis=inner.getDatumAxis();
+		Primitive* p=nullptr;
+		if(axis==Axis::None) {
+			/* Repeated placements of the same children share one
+			 * evaluation of them */
+			p=instancer->place(inner,[&inner,this]() {
+				return unionChildren(inner);
+			});
+		} else {
+			p=unionChildren(inner);
+		}
+		if(!p) return noResult();
 		if(axis!=Axis::None) {
 			CGALAuxiliaryBuilder b(reporter);
 			p=b.buildDatumsPrimitive(p,axis);
 		}
+#else
+		Primitive* p=unionChildren(inner);
+		if(!p) return noResult();
 #endif
-		p->transform(n.getMatrix());
+		if(found) p->transform(&m);
 		return p;
 	});
 }
 
 void GeometryEvaluator::visit(const ResizeNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 		if(p) p->resize(n.getAutoSize(),n.getSize());
 		return p;
@@ -381,7 +526,7 @@ void GeometryEvaluator::visit(const ResizeNode& n)
 
 void GeometryEvaluator::visit(const AlignNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 		if(p) p->align(n.getCenter(),n.getAlign());
 		return p;
@@ -390,14 +535,14 @@ void GeometryEvaluator::visit(const AlignNode& n)
 
 void GeometryEvaluator::visit(const PointsNode& n)
 {
-	result=QtConcurrent::run(pool,[&n]() {
+	result=run([&n]() {
 		return n.getPrimitive();
 	});
 }
 
 void GeometryEvaluator::visit(const SliceNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 		return p?p->slice(n.getHeight(),n.getThickness()):noResult();
 	});
@@ -405,7 +550,7 @@ void GeometryEvaluator::visit(const SliceNode& n)
 
 void GeometryEvaluator::visit(const ProductNode& n)
 {
-	result=QtConcurrent::run(pool,[&n]() {
+	result=run([&n]() {
 		Primitive* p=n.getPrimitive();
 		return p?p->copy():noResult();
 	});
@@ -413,7 +558,7 @@ void GeometryEvaluator::visit(const ProductNode& n)
 
 void GeometryEvaluator::visit(const ProjectionNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 		return p?p->projection(n.getBase()):noResult();
 	});
@@ -421,7 +566,7 @@ void GeometryEvaluator::visit(const ProjectionNode& n)
 
 void GeometryEvaluator::visit(const DecomposeNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 		return p?p->decompose():noResult();
 	});
@@ -429,7 +574,7 @@ void GeometryEvaluator::visit(const DecomposeNode& n)
 
 void GeometryEvaluator::visit(const ComplementNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 		return p?p->complement():noResult();
 	});
@@ -437,7 +582,7 @@ void GeometryEvaluator::visit(const ComplementNode& n)
 
 void GeometryEvaluator::visit(const RadialsNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 #ifdef USE_CGAL
 		CGALAuxiliaryBuilder b(reporter);
@@ -450,7 +595,7 @@ void GeometryEvaluator::visit(const RadialsNode& n)
 
 void GeometryEvaluator::visit(const VolumesNode& n)
 {
-	result=QtConcurrent::run(pool,[&n,this]() {
+	result=run([&n,this]() {
 		Primitive* p=unionChildren(n);
 #ifdef USE_CGAL
 		CGALAuxiliaryBuilder b(reporter);
@@ -463,5 +608,13 @@ void GeometryEvaluator::visit(const VolumesNode& n)
 
 Primitive* GeometryEvaluator::getResult() const
 {
-	return result.result();
+	try {
+		return result.result();
+	} catch(...) {
+		/* The children that were evaluated before the failure are no
+		 * longer needed */
+		if(partial)
+			partial->dispose();
+		throw;
+	}
 }
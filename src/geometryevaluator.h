@@ -55,8 +55,12 @@
 #include "nodevisitor.h"
 #include "primitive.h"
 #include "reporter.h"
+#include <QSharedPointer>
 #include <QtConcurrent>
 
+class CGALInstancer;
+class EvaluationProgress;
+
 class GeometryEvaluator : public NodeVisitor
 {
 	Q_DECLARE_TR_FUNCTIONS(GeometryEvaluator)
@@ -99,20 +103,32 @@ public:
 	void visit(const ChildrenNode&) override;
 	Primitive* getResult() const override;
 private:
+	GeometryEvaluator(Reporter&,CGALInstancer*);
+	class PartialResults;
 	class MapFunctor;
 	class ReduceFunctor;
+	using Partial=QSharedPointer<PartialResults>;
 	using MapFunction=std::function<Primitive*(Node*)>;
 	using ReduceFunction=std::function<void(Primitive*&,Primitive*)>;
+	using Evaluate=std::function<Primitive*()>;
+	QFuture<Primitive*> run(const Evaluate&);
 	QFuture<Primitive*> reduceChildren(const Node&,const ReduceFunction&,
-		QtConcurrent::ReduceOptions=QtConcurrent::OrderedReduce);
+		QtConcurrent::ReduceOptions=QtConcurrent::OrderedReduce,bool=false);
+	Primitive* blockingReduceChildren(const Node&,const ReduceFunction&);
 	Primitive* unionChildren(const Node&);
 	Primitive* appendChildren(const Node&);
 	Primitive* chainHull(const HullNode& n);
+	Primitive* getPrimitive(const PrimitiveNode&);
 	static Primitive* createPrimitive();
 	static Primitive* noResult();
 	QFuture<Primitive*> result;
+	Partial partial;
 	QThreadPool* pool;
 	Reporter& reporter;
+	CGALInstancer* instancer;
+	bool ownsInstancer;
+	EvaluationProgress* progress;
+	bool root;
 };
 
 #endif // GEOMETRYEVALUATOR_H
@@ -0,0 +1,174 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "importcache.h"
+#include "evaluationsettings.h"
+#include "node/importnode.h"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QMutexLocker>
+#include <contrib/qtcompat.h>
+
+ImportCache::ImportCache() :
+	disabled(true)
+{
+}
+
+ImportCache::~ImportCache()
+{
+	flushCaches();
+}
+
+ImportCache& ImportCache::getInstance()
+{
+	static ImportCache instance;
+	return instance;
+}
+
+QString ImportCache::entryKey(const QString& path)
+{
+	/* The fragments of a script depend on the level of detail, keep the
+	 * results of each level so that switching between them reuses both */
+	return path+'@'+EvaluationSettings::current().getLevelOfDetail();
+}
+
+QByteArray ImportCache::hashFile(const QString& path)
+{
+	QFile f(path);
+	if(!f.open(QIODevice::ReadOnly))
+		return QByteArray();
+
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(&f);
+	return hash.result();
+}
+
+bool ImportCache::isCurrent(const Hashes& hashes)
+{
+	for(auto it=hashes.constBegin(); it!=hashes.constEnd(); ++it)
+		if(hashFile(it.key())!=it.value())
+			return false;
+	return true;
+}
+
+Primitive* ImportCache::fetch(const QFileInfo& info,Reporter& r)
+{
+	const QString& key=entryKey(info.absoluteFilePath());
+	Hashes hashes;
+	{
+		const QMutexLocker locker(&mutex);
+		if(disabled)
+			return nullptr;
+		const auto& it=entries.constFind(key);
+		if(it==entries.constEnd())
+			return nullptr;
+		hashes=it->hashes;
+	}
+
+	/* Hash the files outside of the lock, reading them is cheap compared
+	 * to evaluating the script again but still worth doing concurrently */
+	if(!isCurrent(hashes))
+		return nullptr;
+
+	Primitive* result=nullptr;
+	QString output;
+	QString messages;
+	{
+		const QMutexLocker locker(&mutex);
+		const auto& it=entries.constFind(key);
+		if(it==entries.constEnd() || it->hashes!=hashes)
+			return nullptr;
+
+		/* Copies share the underlying geometry until one of them is
+		 * modified */
+		result=it->primitive->copy();
+		output=it->output;
+		messages=it->messages;
+	}
+
+	/* The warnings and echoes of the script are part of its result */
+	QTextStream& out=r.getOutput();
+	out << output;
+	out.flush();
+	r.reportMessages(messages);
+	return result;
+}
+
+void ImportCache::store(const QFileInfo& info,QStringList dependencies,Primitive* pr,const QString& output,const QString& messages)
+{
+	if(!pr)
+		return;
+
+	const QString& path=info.absoluteFilePath();
+	dependencies.prepend(path);
+
+	Hashes hashes;
+	for(const auto& d: std::as_const(dependencies))
+		hashes.insert(d,hashFile(d));
+
+	const QMutexLocker locker(&mutex);
+	if(disabled)
+		return;
+
+	/* Nested scripts were stored before the script that imports them, so
+	 * take over their dependencies to make the check transitive */
+	for(const auto& d: std::as_const(dependencies)) {
+		const auto& it=entries.constFind(entryKey(d));
+		if(it!=entries.constEnd() && d!=path)
+			hashes.insert(it->hashes);
+	}
+
+	const QString& key=entryKey(path);
+	const auto& it=entries.find(key);
+	if(it!=entries.end()) {
+		delete it->primitive;
+		entries.erase(it);
+	}
+	entries.insert(key,Entry{pr->copy(),hashes,output,messages});
+}
+
+void ImportCache::collectImports(const Node& n,QStringList& files)
+{
+	const auto* i=dynamic_cast<const ImportNode*>(&n);
+	if(i)
+		files.append(QFileInfo(i->getImport()).absoluteFilePath());
+
+	for(Node* c: n.getChildren())
+		collectImports(*c,files);
+}
+
+void ImportCache::flushCaches()
+{
+	const QMutexLocker locker(&mutex);
+	for(const auto& e: std::as_const(entries))
+		delete e.primitive;
+	entries.clear();
+}
+
+void ImportCache::disableCaches()
+{
+	flushCaches();
+	const QMutexLocker locker(&mutex);
+	disabled=true;
+}
+
+void ImportCache::enableCaches()
+{
+	const QMutexLocker locker(&mutex);
+	disabled=false;
+}
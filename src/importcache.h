@@ -0,0 +1,66 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMPORTCACHE_H
+#define IMPORTCACHE_H
+
+#include "node.h"
+#include "primitive.h"
+#include "reporter.h"
+#include <QByteArray>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+
+class ImportCache
+{
+	Q_DISABLE_COPY_MOVE(ImportCache)
+public:
+	static ImportCache& getInstance();
+	/**
+	 * @brief Fetch the result of evaluating the given script, and replay
+	 * the output and messages of that evaluation to the reporter.
+	 * @return A copy of the cached result, or nullptr when the script, or
+	 * any of the files it depends on, has changed since it was stored.
+	 */
+	Primitive* fetch(const QFileInfo&,Reporter&);
+	void store(const QFileInfo&,QStringList dependencies,Primitive*,const QString& output,const QString& messages);
+	static void collectImports(const Node&,QStringList&);
+	void flushCaches();
+	void disableCaches();
+	void enableCaches();
+private:
+	ImportCache();
+	~ImportCache();
+	using Hashes=QHash<QString,QByteArray>;
+	struct Entry {
+		Primitive* primitive;
+		Hashes hashes;
+		QString output;
+		QString messages;
+	};
+	static QString entryKey(const QString&);
+	static QByteArray hashFile(const QString&);
+	static bool isCurrent(const Hashes&);
+	QHash<QString,Entry> entries;
+	QMutex mutex;
+	bool disabled;
+};
+
+#endif // IMPORTCACHE_H
@@ -19,9 +19,16 @@
 #include "interactive.h"
 
 #include "assertexception.h"
-#include "script.h"
+#include "cachemanager.h"
+#include "export.h"
+#include "geometryevaluator.h"
+#include "node/unionnode.h"
+#include "nodeevaluator.h"
+#include "preferences.h"
+#include "scriptcache.h"
 #include "tokenreader.h"
-#include "treeevaluator.h"
+#include <QFileInfo>
+#include <QScopedPointer>
 #ifdef USE_CGAL
 #include <CGAL/exceptions.h>
 #endif
@@ -35,10 +42,30 @@ namespace readline
 
 Interactive::Interactive(Reporter& r,QObject* parent) :
 	QObject(parent),
-	Strategy(r)
+	Strategy(r),
+	evaluator(nullptr)
 {
 }
 
+Interactive::~Interactive()
+{
+	resetSession();
+}
+
+void Interactive::resetSession()
+{
+	qDeleteAll(primitives);
+	primitives.clear();
+	qDeleteAll(nodes);
+	nodes.clear();
+	/* The evaluator refers to the declarations of the scripts, so it has
+	 * to go first */
+	delete evaluator;
+	evaluator=nullptr;
+	qDeleteAll(scripts);
+	scripts.clear();
+}
+
 bool Interactive::isExpression(const QString& s)
 {
 	TokenReader t(s);
@@ -52,24 +79,13 @@ bool Interactive::isExpression(const QString& s)
 
 void Interactive::execCommand(const QString& str)
 {
+	const Reporter::Scope reports(reporter);
 	try {
-		QString s(str);
-		if(isExpression(s)) {
-			s=QString("writeln(%1);").arg(s);
-			/* Use a position offset 'kludge' so that the reporter doesn't include
-			 * the 'write(' characters in its 'at character' output */
-			reporter.setPositionOffset(-8);
-		} else {
-			reporter.setPositionOffset(0);
-		}
-
-		Script sc(reporter);
-		sc.parse(s);
-		TreeEvaluator e(reporter);
-		sc.accept(e);
-		Node* n=e.getRootNode();
+		if(str.startsWith(':'))
+			execSessionCommand(str.mid(1).trimmed());
+		else
+			evaluateCommand(str);
 		output.flush();
-		delete n;
 #ifdef USE_CGAL
 	} catch(const CGAL::Failure_exception& e) {
 		reporter.reportException(QString::fromStdString(e.what()));
@@ -81,6 +97,92 @@ void Interactive::execCommand(const QString& str)
 	}
 }
 
+void Interactive::evaluateCommand(const QString& str)
+{
+	QString s(str);
+	if(isExpression(s)) {
+		s=QString("writeln(%1);").arg(s);
+		/* Use a position offset 'kludge' so that the reporter doesn't include
+		 * the 'write(' characters in its 'at character' output */
+		reporter.setPositionOffset(-8);
+	} else {
+		reporter.setPositionOffset(0);
+	}
+
+	/* Each command is kept for the rest of the session because the
+	 * modules, functions and values it declares are used by the commands
+	 * that follow it */
+	auto* sc=new Script(reporter);
+	scripts.append(sc);
+	sc->parse(s);
+	if(!evaluator)
+		evaluator=new TreeEvaluator(reporter);
+	evaluator->resume(*sc);
+
+	Node* n=evaluator->getRootNode();
+	if(n && n->childCount()==0 && dynamic_cast<UnionNode*>(n))
+		delete n;
+	else if(n)
+		nodes.append(n);
+}
+
+void Interactive::execSessionCommand(const QString& command)
+{
+	const QString& name=command.section(' ',0,0);
+	const QString& argument=command.section(' ',1).trimmed();
+	if(name=="export" && !argument.isEmpty()) {
+		exportResult(argument);
+	} else if(name=="reset") {
+		resetSession();
+	} else {
+		reporter.reportWarning(tr("unknown command ':%1', use ':export <file>' or ':reset'.").arg(name));
+	}
+}
+
+Primitive* Interactive::evaluateNodes()
+{
+	/* The geometry of each command is kept once it has been evaluated, so
+	 * only the commands entered since the last export are evaluated */
+	auto& p=Preferences::getInstance();
+	while(!nodes.isEmpty()) {
+		const QScopedPointer<Node> n(nodes.takeFirst());
+		QScopedPointer<NodeVisitor> v;
+		if(p.getThreadPoolSize()==0)
+			v.reset(new NodeEvaluator(reporter));
+		else
+			v.reset(new GeometryEvaluator(reporter));
+		n->accept(*v);
+		Primitive* pr=v->getResult();
+		if(pr)
+			primitives.append(pr);
+	}
+
+	Primitive* result=nullptr;
+	for(Primitive* pr: std::as_const(primitives)) {
+		Primitive* c=pr->copy();
+		if(result)
+			result->joinLater(c);
+		else
+			result=c;
+	}
+	return result?result->combine():nullptr;
+}
+
+void Interactive::exportResult(const QString& fileName)
+{
+	reporter.startTiming();
+	const QScopedPointer<Primitive> pr(evaluateNodes());
+	if(!pr) {
+		reporter.reportWarning(tr("no top level object."));
+		return;
+	}
+
+	const QFileInfo file(fileName);
+	const Export exporter(pr.data(),reporter);
+	exporter.exportResult(file);
+	reporter.reportTiming(tr("export"));
+}
+
 static constexpr auto PROMPT="\u042F: ";
 
 QString Interactive::getPrompt()
@@ -91,9 +193,20 @@ QString Interactive::getPrompt()
 int Interactive::evaluate()
 {
 #ifdef USE_READLINE
+	/* Used libraries are parsed once and the geometry of repeated
+	 * subtrees is reused for as long as the session lasts */
+	auto& cm=CacheManager::getInstance();
+	cm.enableCaches();
+	auto& sc=ScriptCache::getInstance();
+	sc.enableCaches();
+
 	while(char* c=readline::readline(PROMPT))
 		execCommand(c);
 	output << Qt::endl;
+
+	resetSession();
+	sc.disableCaches();
+	cm.disableCaches();
 #endif
 	return EXIT_SUCCESS;
 }
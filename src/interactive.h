@@ -19,21 +19,44 @@
 #ifndef INTERACTIVE_H
 #define INTERACTIVE_H
 
+#include "node.h"
+#include "primitive.h"
 #include "reporter.h"
+#include "script.h"
 #include "strategy.h"
+#include "treeevaluator.h"
+#include <QList>
 #include <QString>
 
+/**
+ * @brief An interactive session in which each command carries on from
+ * the ones before it. Variables, modules, functions and used libraries
+ * stay defined, and the geometry of each command is evaluated once, when
+ * it is first exported.
+ */
 class Interactive : public QObject,public Strategy
 {
 	Q_OBJECT
+	Q_DISABLE_COPY_MOVE(Interactive)
 public:
 	Interactive(Reporter&, QObject* parent=nullptr);
+	~Interactive() override;
 	static QString getPrompt();
 	int evaluate() override;
 public slots:
 	void execCommand(const QString&);
 private:
 	static bool isExpression(const QString& s);
+	void execSessionCommand(const QString&);
+	void evaluateCommand(const QString&);
+	void exportResult(const QString&);
+	Primitive* evaluateNodes();
+	void resetSession();
+
+	TreeEvaluator* evaluator;
+	QList<Script*> scripts;
+	QList<Node*> nodes;
+	QList<Primitive*> primitives;
 };
 
 #endif // INTERACTIVE_H
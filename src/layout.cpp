@@ -77,6 +77,11 @@ void Layout::addFunction(const Function& func)
 	functions.insert(name,&func);
 }
 
+Scope* Layout::getScope() const
+{
+	return scope;
+}
+
 void Layout::setScope(Scope* sc)
 {
 	scope=sc;
@@ -42,6 +42,7 @@ public:
 	void addFunction(const Function&);
 
 	bool inScope(Scope*) const;
+	Scope* getScope() const;
 	void setScope(Scope*);
 
 private:
@@ -22,7 +22,7 @@
 #include "textvalue.h"
 #include <contrib/qtcompat.h>
 
-EchoModule::EchoModule(Reporter& r) : Module(r,"echo"), output(r.output)
+EchoModule::EchoModule(Reporter& r) : Module(r,"echo")
 {
 	addDeprecated(tr("The echo module is deprecated please use 'write' or 'writeln' module instead."));
 }
@@ -38,6 +38,7 @@ Node* EchoModule::evaluate(const Context& ctx) const
 	if(depricateWarning())
 		reporter.reportWarning(tr("'echo' module is deprecated please use 'write' or 'writeln'\n"));
 
+	QTextStream& output=reporter.getOutput();
 	output << "ECHO: ";
 	const QList<NamedValue>& args=ctx.getArguments();
 
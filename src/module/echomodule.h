@@ -29,7 +29,6 @@ public:
 	explicit EchoModule(Reporter&);
 	Node* evaluate(const Context&) const override;
 private:
-	QTextStream& output;
 	static bool depricateWarning();
 };
 
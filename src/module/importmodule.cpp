@@ -17,6 +17,7 @@
  */
 
 #include "importmodule.h"
+#include "booleanvalue.h"
 #include "context.h"
 #include "node/importnode.h"
 #include "textvalue.h"
@@ -25,15 +26,19 @@ ImportModule::ImportModule(Reporter& r) : Module(r,"import")
 {
 	addDeprecated(tr("The import module is depricated please use the import declaration instead."));
 	addParameter("file", "str",tr("The name of the file to import."));
+	addParameter("fill", "bool",tr("Specifies whether holes in an open mesh are filled to close it."));
 }
 
 Node* ImportModule::evaluate(const Context& ctx) const
 {
 	auto* fileVal=getParameterArgument<TextValue>(ctx,0);
-	if(fileVal)
-		return new ImportNode(fileVal->getValueString());
+	auto* n=new ImportNode(fileVal?fileVal->getValueString():import);
 
-	return new ImportNode(import);
+	auto* fillVal=getParameterArgument<BooleanValue>(ctx,1);
+	if(fillVal)
+		n->setFillHoles(fillVal->isTrue());
+
+	return n;
 }
 
 void ImportModule::setImport(const QString& imp)
@@ -19,6 +19,7 @@
 #include "primitivemodule.h"
 
 #include "rmath.h"
+#include "unitcircle.h"
 
 PrimitiveModule::PrimitiveModule(Reporter& r, const QString& n) : Module(r,n)
 {
@@ -37,10 +38,12 @@ QList<Point> PrimitiveModule::getSpiral(const decimal& r,int f,int n,const decim
 	const auto dz=(z2-z1)/n;
 	const auto dgz=dz>0.0;
 
+	auto& u=UnitCircle::getInstance();
+	const auto& points=u.getPoints(f,n);
 	for(auto i=0; i<n; ++i) {
-		const decimal& phi=(r_tau()*i)/f;
-		const decimal x=r*r_cos(phi);
-		const decimal y=r*r_sin(phi);
+		const UnitCircle::Entry& e=points.at(i);
+		const decimal x=r*e.cos;
+		const decimal y=r*e.sin;
 		const decimal z=dgz?z1+(i*dz):z1;
 		const Point p(x,y,z);
 		circle.append(p);
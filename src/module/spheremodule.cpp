@@ -20,7 +20,7 @@
 #include "context.h"
 #include "node/pointsnode.h"
 #include "numbervalue.h"
-#include "rmath.h"
+#include "unitcircle.h"
 
 SphereModule::SphereModule(Reporter& r) : PrimitiveModule(r,"sphere")
 {
@@ -54,10 +54,14 @@ Node* SphereModule::evaluate(const Context& ctx) const
 	Primitive* p=pn->createPrimitive();
 	pn->setChildren(ctx.getInputNodes());
 
+	/* The ring angles pi*(i+0.5)/ringCount are the odd points of a circle
+	 * divided into 4*ringCount fragments */
+	auto& u=UnitCircle::getInstance();
+	const auto& rings=u.getPoints(4*ringCount,2*ringCount);
 	for(auto i=0; i<ringCount; ++i) {
-		const decimal& phi = (r_pi()*(i+0.5)) / ringCount;
-		const decimal& r2 = r*r_sin(phi);
-		const decimal& z = r*r_cos(phi);
+		const UnitCircle::Entry& e=rings.at(2*i+1);
+		const decimal& r2 = r*e.sin;
+		const decimal& z = r*e.cos;
 		const QList<Point> c = getCircle(r2,f,z);
 		for(const auto& pt: c) {
 			p->createVertex(pt);
@@ -21,18 +21,18 @@
 #include "onceonly.h"
 
 WriteModule::WriteModule(Reporter& r) :
-	Module(r,"write"),
-	output(r.output)
+	Module(r,"write")
 {
 	addDescription(tr("Write the given text to the console window."));
 }
 
-WriteModule::WriteModule(Reporter& r, const QString& n) : Module(r,n), output(r.output)
+WriteModule::WriteModule(Reporter& r, const QString& n) : Module(r,n)
 {
 }
 
 Node* WriteModule::evaluate(const Context& ctx) const
 {
+	QTextStream& output=reporter.getOutput();
 	const QList<NamedValue>& args=ctx.getArguments();
 	OnceOnly first;
 	for(const auto& a: args) {
@@ -46,5 +46,5 @@ Node* WriteModule::evaluate(const Context& ctx) const
 
 void WriteModule::newLine() const
 {
-	output << Qt::endl;
+	reporter.getOutput() << Qt::endl;
 }
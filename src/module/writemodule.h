@@ -31,8 +31,6 @@ public:
 	Node* evaluate(const Context&) const override;
 protected:
 	void newLine() const;
-private:
-	QTextStream& output;
 };
 
 #endif // WRITEMODULE_H
@@ -19,7 +19,8 @@
 #include "importnode.h"
 
 ImportNode::ImportNode(const QString& imp) :
-	import(imp)
+	import(imp),
+	fillHoles(false)
 {
 }
 
@@ -32,3 +33,13 @@ QString ImportNode::getImport() const
 {
 	return import;
 }
+
+bool ImportNode::getFillHoles() const
+{
+	return fillHoles;
+}
+
+void ImportNode::setFillHoles(bool f)
+{
+	fillHoles=f;
+}
@@ -28,8 +28,11 @@ public:
 	explicit ImportNode(const QString&);
 	void accept(NodeVisitor&) override;
 	QString getImport() const;
+	bool getFillHoles() const;
+	void setFillHoles(bool);
 private:
 	QString import;
+	bool fillHoles;
 };
 
 #endif // IMPORTNODE_H
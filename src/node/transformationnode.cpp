@@ -53,3 +53,26 @@ void TransformationNode::setDatumAxis(const Axis& value)
 {
 	datumAxis = value;
 }
+
+const TransformationNode& TransformationNode::compose(TransformMatrix& composed,bool& found) const
+{
+	const TransformationNode* inner=this;
+	composed=TransformMatrix();
+	found=false;
+	for(;;) {
+		if(inner->matrix) {
+			composed=found?composed*(*inner->matrix):*inner->matrix;
+			found=true;
+		}
+		if(inner->datumAxis!=Axis::None)
+			break;
+		const QList<Node*>& children=inner->getChildren();
+		if(children.size()!=1)
+			break;
+		auto* next=dynamic_cast<TransformationNode*>(children.first());
+		if(!next)
+			break;
+		inner=next;
+	}
+	return *inner;
+}
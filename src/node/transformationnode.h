@@ -39,6 +39,14 @@ public:
 	void setMatrix(TransformMatrix*);
 	Axis getDatumAxis() const;
 	void setDatumAxis(const Axis&);
+
+	/**
+	 * @brief Follow a chain of directly nested transformations.
+	 * @param composed Receives the product of the matrices along the chain.
+	 * @param found Set when the chain has at least one matrix to apply.
+	 * @return The innermost transformation whose children are to be evaluated.
+	 */
+	const TransformationNode& compose(TransformMatrix& composed,bool& found) const;
 private:
 	TransformMatrix* matrix;
 	Axis datumAxis;
@@ -19,6 +19,7 @@
 #include "nodeevaluator.h"
 
 #include "cachemanager.h"
+#include "evaluationprogress.h"
 #include "polyhedron.h"
 
 #ifdef USE_CGAL
@@ -29,7 +30,13 @@
 
 NodeEvaluator::NodeEvaluator(Reporter& r) :
 	reporter(r),
-	result(nullptr)
+	result(nullptr),
+	subtrees(nullptr),
+	depth(0),
+	previewing(false)
+#ifdef USE_CGAL
+	,instancer(keys)
+#endif
 {
 	auto& m=CacheManager::getInstance();
 	cache=m.getCache();
@@ -48,6 +55,10 @@ void NodeEvaluator::visit(const PrimitiveNode& n)
 {
 	Primitive* cp=n.getPrimitive();
 	cp=cache->fetch(cp);
+#ifdef USE_CGAL
+	auto* p=dynamic_cast<CGALPrimitive*>(cp);
+	if(p) p->repair(reporter);
+#endif
 	if(!evaluate(n,Operations::Union,cp)) return;
 }
 
@@ -75,11 +86,14 @@ void NodeEvaluator::visit(const DiscreteNode& n)
 
 void NodeEvaluator::visit(const UnionNode& op)
 {
+	/* The top level objects can be shown as soon as each is finished */
+	previewing=(depth==0);
 	if(!evaluate(op,Operations::Union)) return;
 }
 
 void NodeEvaluator::visit(const GroupNode& op)
 {
+	previewing=(depth==0);
 	if(!evaluate(op,Operations::Group)) return;
 }
 
@@ -117,7 +131,7 @@ void NodeEvaluator::visit(const HullNode& n)
 		Primitive* first=nullptr;
 		Primitive* previous=nullptr;
 		for(Node* c: n.getChildren()) {
-			c->accept(*this);
+			descend(*c);
 			if(!previous) {
 				first=result;
 			} else {
@@ -136,7 +150,7 @@ void NodeEvaluator::visit(const HullNode& n)
 	} else {
 		auto* cp=createPrimitive();
 		for(Node* c: n.getChildren()) {
-			c->accept(*this);
+			descend(*c);
 			if(result)
 				cp->appendChild(result);
 		}
@@ -182,35 +196,51 @@ bool NodeEvaluator::evaluate(const Node& op,Operations type,Primitive* first)
 
 bool NodeEvaluator::evaluate(const QList<Node*>& children, Operations type, Primitive* first)
 {
-	for(Node* n: children) {
-		n->accept(*this);
-		if(!first) {
-			first=result;
-		} else if(result) {
-			switch(type) {
-				case Operations::Group:
-					first->groupLater(result);
-					break;
-				case Operations::Union:
-					first->joinLater(result);
-					break;
-				case Operations::Difference:
-					first=first->difference(result);
-					break;
-				case Operations::Intersection:
-					first=first->intersection(result);
-					break;
-				case Operations::SymmetricDifference:
-					first=first->symmetric_difference(result);
-					break;
-				case Operations::Minkowski:
-					first=first->minkowski(result);
-					break;
-				case Operations::Glide:
-					first=first->glide(result);
-					break;
+	const bool preview=previewing&&depth==0;
+	result=nullptr;
+	try {
+		for(Node* n: children) {
+			evaluateChild(*n);
+			if(preview && result)
+				EvaluationProgress::preview(*result);
+			if(!first) {
+				first=result;
+			} else if(result) {
+				switch(type) {
+					case Operations::Group:
+						first->groupLater(result);
+						break;
+					case Operations::Union:
+						first->joinLater(result);
+						break;
+					case Operations::Difference:
+						first=first->difference(result);
+						break;
+					case Operations::Intersection:
+						first=first->intersection(result);
+						break;
+					case Operations::SymmetricDifference:
+						first=first->symmetric_difference(result);
+						break;
+					case Operations::Minkowski:
+						first=first->minkowski(result);
+						break;
+					case Operations::Glide:
+						first=first->glide(result);
+						break;
+				}
 			}
+			/* From here on the result is held by the first child */
+			result=nullptr;
 		}
+	} catch(...) {
+		/* Cancelling, or failing, part way leaves the children evaluated
+		 * so far to be deleted */
+		if(result!=first)
+			delete result;
+		delete first;
+		result=nullptr;
+		throw;
 	}
 
 	if(first)
@@ -221,6 +251,41 @@ bool NodeEvaluator::evaluate(const QList<Node*>& children, Operations type, Prim
 	return (result!=nullptr);
 }
 
+void NodeEvaluator::evaluateChild(Node& n)
+{
+	if(!subtrees) {
+		descend(n);
+		return;
+	}
+
+	QByteArray key;
+	Primitive* cached=subtrees->fetch(n,keys,key);
+	if(cached) {
+		result=cached;
+		return;
+	}
+	descend(n);
+	subtrees->store(key,result);
+}
+
+/* Restores the depth however the descent into a child ends */
+class Descent
+{
+	Q_DISABLE_COPY_MOVE(Descent)
+public:
+	explicit Descent(int& d) : depth(d) { ++depth; }
+	~Descent() { --depth; }
+private:
+	int& depth;
+};
+
+void NodeEvaluator::descend(Node& n)
+{
+	EvaluationProgress::check();
+	const Descent descent(depth);
+	n.accept(*this);
+}
+
 void NodeEvaluator::noResult(const Node&)
 {
 	delete result;
@@ -327,7 +392,7 @@ void NodeEvaluator::visit(const ImportNode& op)
 {
 #ifdef USE_CGAL
 	const QFileInfo file(op.getImport());
-	const CGALImport i(file,reporter);
+	const CGALImport i(file,reporter,op.getFillHoles());
 	result=i.import();
 #else
 	return noResult(op);
@@ -336,16 +401,31 @@ void NodeEvaluator::visit(const ImportNode& op)
 
 void NodeEvaluator::visit(const TransformationNode& tr)
 {
-	if(!evaluate(tr,Operations::Union)) return;
+	/* Nested transformations are composed so that the exact geometry
+	 * of the innermost children is only transformed once */
+	TransformMatrix m;
+	bool found;
+	const TransformationNode& inner=tr.compose(m,found);
 #ifdef USE_CGAL
 	using Axis = TransformationNode::Axis;
-	const Axis axis=tr.getDatumAxis();
-	if(axis!=Axis::None) {
+	const Axis axis=inner.getDatumAxis();
+	if(axis==Axis::None) {
+		/* Repeated placements of the same children share one
+		 * evaluation of them */
+		result=instancer.place(inner,[&inner,this]() {
+			evaluate(inner,Operations::Union);
+			return result;
+		});
+		if(!result) return;
+	} else {
+		if(!evaluate(inner,Operations::Union)) return;
 		CGALAuxiliaryBuilder b(reporter);
 		result=b.buildDatumsPrimitive(result,axis);
 	}
+#else
+	if(!evaluate(inner,Operations::Union)) return;
 #endif
-	result->transform(tr.getMatrix());
+	if(found) result->transform(&m);
 }
 
 void NodeEvaluator::visit(const ResizeNode& n)
@@ -429,6 +509,11 @@ void NodeEvaluator::visit(const VolumesNode& n)
 #endif
 }
 
+void NodeEvaluator::setSubtreeCache(SubtreeCache* s)
+{
+	subtrees=s;
+}
+
 Primitive* NodeEvaluator::getResult() const
 {
 	return result;
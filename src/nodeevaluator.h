@@ -58,6 +58,10 @@
 #include "reporter.h"
 
 #include "cache.h"
+#include "subtreecache.h"
+#ifdef USE_CGAL
+#include "cgalinstancer.h"
+#endif
 
 class NodeEvaluator : public NodeVisitor
 {
@@ -101,6 +105,7 @@ public:
 	void visit(const ChildrenNode&) override;
 
 	Primitive* getResult() const override;
+	void setSubtreeCache(SubtreeCache*);
 private:
 	enum class Operations {
 		Group,
@@ -115,11 +120,20 @@ private:
 	bool evaluate(const Node&,Operations);
 	bool evaluate(const Node&,Operations,Primitive*);
 	bool evaluate(const QList<Node*>&,Operations,Primitive*);
+	void evaluateChild(Node&);
+	void descend(Node&);
 	void noResult(const Node&);
 
 	Reporter& reporter;
 	Primitive* result;
 	Cache* cache;
+	SubtreeCache* subtrees;
+	SubtreeKeys keys;
+	int depth;
+	bool previewing;
+#ifdef USE_CGAL
+	CGALInstancer instancer;
+#endif
 };
 
 #endif // NODEEVALUATOR_H
@@ -20,7 +20,9 @@
 #include "onceonly.h"
 #include "polyhedron.h"
 
-NodePrinter::NodePrinter(QTextStream& s) : result(s)
+NodePrinter::NodePrinter(QTextStream& s) :
+	result(s),
+	shallow(false)
 {
 }
 
@@ -30,6 +32,16 @@ NodePrinter::~NodePrinter()
 	primitives.clear();
 }
 
+void NodePrinter::releasePrimitives()
+{
+	primitives.clear();
+}
+
+void NodePrinter::setShallow(bool value)
+{
+	shallow=value;
+}
+
 void NodePrinter::collectChildren(const Node& n)
 {
 	for(auto* child: n.getChildren()) {
@@ -212,13 +224,18 @@ void NodePrinter::visit(const ImportNode& im)
 {
 	result << "import(\"";
 	result << im.getImport();
-	result << "\");";
+	result << "\"";
+	if(im.getFillHoles())
+		result << ",fill=true";
+	result << ");";
 }
 
 void NodePrinter::printChildren(const Node& n)
 {
 	const QList<Node*>& children = n.getChildren();
-	if(children.length()>0) {
+	if(children.length()>0 && shallow) {
+		result << "{}";
+	} else if(children.length()>0) {
 		result << "{";
 		for(Node* c: children)
 			c->accept(*this);
@@ -101,8 +101,14 @@ public:
 	void visit(const SolidNode&) override;
 	void visit(const ChildrenNode&) override;
 	Primitive* getResult() const override { return nullptr; }
+	void releasePrimitives();
+	/**
+	 * @brief Print each node without the subtrees of its children.
+	 */
+	void setShallow(bool);
 private:
 	QTextStream& result;
+	bool shallow;
 	void collectChildren(const Node&);
 	void printChildren(const Node&);
 	void printArguments(const QList<Point>&);
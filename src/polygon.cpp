@@ -19,6 +19,38 @@
 #include "polygon.h"
 #include "primitive.h"
 
+Polygon::Indexes::Indexes(const size_type* b,const size_type* e) :
+	first(b),
+	last(e)
+{
+}
+
+const Polygon::size_type* Polygon::Indexes::begin() const
+{
+	return first;
+}
+
+const Polygon::size_type* Polygon::Indexes::end() const
+{
+	return last;
+}
+
+Polygon::size_type Polygon::Indexes::size() const
+{
+	return static_cast<size_type>(last-first);
+}
+
+bool Polygon::Indexes::isEmpty() const
+{
+	return first==last;
+}
+
+Polygon::size_type Polygon::Indexes::at(size_type i) const
+{
+	Q_ASSERT(i>=0 && i<size());
+	return first[i];
+}
+
 Polygon::Polygon(Primitive& p) : parent(p)
 {
 }
@@ -37,17 +69,21 @@ QList<Point> Polygon::getPoints() const
 {
 	const QList<Point>& parentPoints=parent.getPoints();
 	QList<Point> points;
-	for(auto i: indexes)
+	for(auto i: getIndexes())
 		points.append(parentPoints.at(i));
 	return points;
 }
 
-const QList<Polygon::size_type>& Polygon::getIndexes() const
+Polygon::Indexes Polygon::getIndexes() const
 {
-	return indexes;
+	const size_type* data=indexes.constData();
+	return Indexes(data,data+indexes.size());
 }
 
-void Polygon::setIndexes(const QList<size_type>& value)
+void Polygon::setIndexes(const Indexes& value)
 {
-	indexes=value;
+	indexes.clear();
+	indexes.reserve(value.size());
+	for(auto i: value)
+		indexes.append(i);
 }
@@ -29,22 +29,43 @@ class Primitive;
 
 #include "point.h"
 #include <QList>
+#include <QVector>
 
 class Polygon
 {
 	Q_DISABLE_COPY_MOVE(Polygon)
 public:
 	using size_type=QList<Point>::size_type;
+
+	/**
+	 * @brief A read only view of the indexes of a polygon, it is only valid
+	 * until the polygons of the primitive are next modified.
+	 */
+	class Indexes
+	{
+	public:
+		Indexes(const size_type*,const size_type*);
+		const size_type* begin() const;
+		const size_type* end() const;
+		size_type size() const;
+		bool isEmpty() const;
+		size_type at(size_type) const;
+	private:
+		const size_type* first;
+		const size_type* last;
+	};
+
 	explicit Polygon(Primitive&);
 	virtual ~Polygon()=default;
-	void append(size_type);
-	void prepend(size_type);
+	virtual void append(size_type);
+	virtual void prepend(size_type);
 	QList<Point> getPoints() const;
-	const QList<size_type>& getIndexes() const;
-	void setIndexes(const QList<size_type>& value);
+	virtual Indexes getIndexes() const;
+	virtual void setIndexes(const Indexes&);
 protected:
-	QList<size_type> indexes;
 	Primitive& parent;
+private:
+	QVector<size_type> indexes;
 };
 
 #endif // POLYGON_H
@@ -17,6 +17,7 @@
  */
 #include "preferences.h"
 
+#include "evaluationsettings.h"
 #include <cmath>
 static constexpr double LOG10_2=0.30102999566398119521; /* log10(2) = log base 10 of 2 */
 
@@ -50,11 +51,16 @@ public:
 	void setValue(const QString& k,const QVariant& v) override
 	{
 		Base::setValue(k,v);
+		/* Invalidating flushes the imports, so only do it when the
+		 * preference can change the results of an evaluation */
+		if(EvaluationSettings::isSetting(k))
+			EvaluationSettings::invalidate();
 	}
 
 	void clear() override
 	{
 		Base::clear();
+		EvaluationSettings::invalidate();
 	}
 };
 
@@ -212,6 +218,26 @@ void Preferences::setThreadPoolSize(int value)
 	settings->setValue("ThreadPoolSize",value);
 }
 
+int Preferences::getPreviewFragmentLimit() const
+{
+	return settings->value("PreviewFragmentLimit",32).toInt();
+}
+
+void Preferences::setPreviewFragmentLimit(int value)
+{
+	settings->setValue("PreviewFragmentLimit",value);
+}
+
+float Preferences::getFragmentScale() const
+{
+	return settings->value("FragmentScale",1.0).toFloat();
+}
+
+void Preferences::setFragmentScale(float value)
+{
+	settings->setValue("FragmentScale",value);
+}
+
 QString Preferences::getIndent() const
 {
 	return settings->value("Indent","\t").toString();
@@ -173,6 +173,12 @@ public:
 	int getThreadPoolSize() const;
 	void setThreadPoolSize(int);
 
+	int getPreviewFragmentLimit() const;
+	void setPreviewFragmentLimit(int);
+
+	float getFragmentScale() const;
+	void setFragmentScale(float);
+
 	bool getVisibleWhiteSpace() const;
 	void setVisibleWhiteSpace(bool);
 
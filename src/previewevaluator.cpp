@@ -0,0 +1,263 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "previewevaluator.h"
+#include "evaluationprogress.h"
+#include "nodeevaluator.h"
+#include "onceonly.h"
+
+PreviewEvaluator::PreviewEvaluator(Reporter& r) :
+	reporter(r)
+{
+}
+
+void PreviewEvaluator::evaluate(const QList<Node*>& children,Operations type)
+{
+	PreviewMesh first;
+	OnceOnly firstChild;
+	for(Node* n: children) {
+		EvaluationProgress::check();
+		n->accept(*this);
+		if(firstChild()) {
+			first=result;
+			continue;
+		}
+		switch(type) {
+			case Operations::Union:
+				first.group(result);
+				break;
+			case Operations::Difference:
+				first.difference(result);
+				break;
+			case Operations::Intersection:
+				first.intersection(result);
+				break;
+			case Operations::SymmetricDifference:
+				first.symmetricDifference(result);
+				break;
+		}
+	}
+	result=first;
+}
+
+template <class T>
+void PreviewEvaluator::evaluateExact(const T& n)
+{
+	NodeEvaluator e(reporter);
+	e.visit(n);
+	Primitive* p=e.getResult();
+	result=p?PreviewMesh(*p):PreviewMesh();
+	delete p;
+}
+
+void PreviewEvaluator::visit(const PrimitiveNode& n)
+{
+	/* Only the polygons of the primitive are needed, and nothing else
+	 * takes it over */
+	PreviewMesh m;
+	Primitive* p=n.getPrimitive();
+	if(p) {
+		m=PreviewMesh(*p);
+		delete p;
+	}
+	evaluate(n.getChildren(),Operations::Union);
+	m.group(result);
+	result=m;
+}
+
+void PreviewEvaluator::visit(const UnionNode& n)
+{
+	evaluate(n.getChildren(),Operations::Union);
+}
+
+void PreviewEvaluator::visit(const GroupNode& n)
+{
+	evaluate(n.getChildren(),Operations::Union);
+}
+
+void PreviewEvaluator::visit(const DifferenceNode& n)
+{
+	evaluate(n.getChildren(),Operations::Difference);
+}
+
+void PreviewEvaluator::visit(const IntersectionNode& n)
+{
+	evaluate(n.getChildren(),Operations::Intersection);
+}
+
+void PreviewEvaluator::visit(const SymmetricDifferenceNode& n)
+{
+	evaluate(n.getChildren(),Operations::SymmetricDifference);
+}
+
+void PreviewEvaluator::visit(const MinkowskiNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const GlideNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const HullNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const LinearExtrudeNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const RotateExtrudeNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const BoundsNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const SubDivisionNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const OffsetNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const BoundaryNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const ImportNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const TransformationNode& n)
+{
+	TransformMatrix m;
+	bool found;
+	const TransformationNode& inner=n.compose(m,found);
+	if(inner.getDatumAxis()!=TransformationNode::Axis::None) {
+		evaluateExact(n);
+		return;
+	}
+
+	evaluate(inner.getChildren(),Operations::Union);
+	if(found) result.transform(&m);
+}
+
+void PreviewEvaluator::visit(const ResizeNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const AlignNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const PointsNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const SliceNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const ProductNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const ProjectionNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const DecomposeNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const ComplementNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const RadialsNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const VolumesNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const TriangulateNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const MaterialNode& n)
+{
+	evaluate(n.getChildren(),Operations::Union);
+}
+
+void PreviewEvaluator::visit(const DiscreteNode& n)
+{
+	/* Rounding the vertices makes no visible difference */
+	evaluate(n.getChildren(),Operations::Union);
+}
+
+void PreviewEvaluator::visit(const NormalsNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const SimplifyNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const SolidNode& n)
+{
+	evaluateExact(n);
+}
+
+void PreviewEvaluator::visit(const ChildrenNode& n)
+{
+	evaluateExact(n);
+}
+
+Primitive* PreviewEvaluator::getResult() const
+{
+	if(result.isEmpty())
+		return nullptr;
+	return result.createPrimitive();
+}
@@ -0,0 +1,90 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PREVIEWEVALUATOR_H
+#define PREVIEWEVALUATOR_H
+
+#include "nodevisitor.h"
+#include "previewmesh.h"
+#include "reporter.h"
+#include <QCoreApplication>
+
+/**
+ * @brief Evaluates a tree of nodes to floating point meshes that are
+ * only good enough to be looked at. Unions are kept as groups of meshes,
+ * differences and intersections are approximated, and everything else is
+ * evaluated exactly and then converted.
+ */
+class PreviewEvaluator : public NodeVisitor
+{
+	Q_DECLARE_TR_FUNCTIONS(PreviewEvaluator)
+public:
+	explicit PreviewEvaluator(Reporter&);
+
+	void visit(const PrimitiveNode&) override;
+	void visit(const UnionNode&) override;
+	void visit(const GroupNode&) override;
+	void visit(const DifferenceNode&) override;
+	void visit(const IntersectionNode&) override;
+	void visit(const SymmetricDifferenceNode&) override;
+	void visit(const MinkowskiNode&) override;
+	void visit(const GlideNode&) override;
+	void visit(const HullNode&) override;
+	void visit(const LinearExtrudeNode&) override;
+	void visit(const RotateExtrudeNode&) override;
+	void visit(const BoundsNode&) override;
+	void visit(const SubDivisionNode&) override;
+	void visit(const OffsetNode&) override;
+	void visit(const BoundaryNode&) override;
+	void visit(const ImportNode&) override;
+	void visit(const TransformationNode&) override;
+	void visit(const ResizeNode&) override;
+	void visit(const AlignNode&) override;
+	void visit(const PointsNode&) override;
+	void visit(const SliceNode&) override;
+	void visit(const ProductNode&) override;
+	void visit(const ProjectionNode&) override;
+	void visit(const DecomposeNode&) override;
+	void visit(const ComplementNode&) override;
+	void visit(const RadialsNode&) override;
+	void visit(const VolumesNode&) override;
+	void visit(const TriangulateNode&) override;
+	void visit(const MaterialNode&) override;
+	void visit(const DiscreteNode&) override;
+	void visit(const NormalsNode&) override;
+	void visit(const SimplifyNode&) override;
+	void visit(const SolidNode&) override;
+	void visit(const ChildrenNode&) override;
+
+	Primitive* getResult() const override;
+private:
+	enum class Operations {
+		Union,
+		Difference,
+		Intersection,
+		SymmetricDifference
+	};
+	void evaluate(const QList<Node*>&,Operations);
+	template <class T>
+	void evaluateExact(const T&);
+
+	Reporter& reporter;
+	PreviewMesh result;
+};
+
+#endif // PREVIEWEVALUATOR_H
@@ -0,0 +1,540 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "previewmesh.h"
+#include "polyhedron.h"
+#include <QPair>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#ifdef USE_CGAL
+#include "cgalexplorer.h"
+#include "cgalprimitive.h"
+#endif
+
+using Vertex=PreviewMesh::Vertex;
+using Plane=PreviewMesh::Plane;
+using Facet=PreviewMesh::Facet;
+
+/* Vertices closer than this to a plane are taken to lie on it */
+static constexpr double epsilon=1e-5;
+
+static Vertex operator+(const Vertex& a,const Vertex& b)
+{
+	return Vertex{a.x+b.x,a.y+b.y,a.z+b.z};
+}
+
+static Vertex operator-(const Vertex& a,const Vertex& b)
+{
+	return Vertex{a.x-b.x,a.y-b.y,a.z-b.z};
+}
+
+static Vertex operator*(const Vertex& a,double s)
+{
+	return Vertex{a.x*s,a.y*s,a.z*s};
+}
+
+static double dot(const Vertex& a,const Vertex& b)
+{
+	return a.x*b.x+a.y*b.y+a.z*b.z;
+}
+
+static Vertex cross(const Vertex& a,const Vertex& b)
+{
+	return Vertex{a.y*b.z-a.z*b.y,a.z*b.x-a.x*b.z,a.x*b.y-a.y*b.x};
+}
+
+static Vertex toVertex(const Point& p)
+{
+#ifdef USE_CGAL
+	return Vertex{CGAL::to_double(p.x()),CGAL::to_double(p.y()),CGAL::to_double(p.z())};
+#else
+	return Vertex{p.x(),p.y(),p.z()};
+#endif
+}
+
+/* Newell's method gives a usable plane even for facets that are slightly
+ * non planar, and tells apart the ones that have no area at all */
+static bool createPlane(const QList<Vertex>& vertices,Plane& plane)
+{
+	Vertex n{0.0,0.0,0.0};
+	Vertex c{0.0,0.0,0.0};
+	const auto size=vertices.size();
+	for(auto i=0; i<size; ++i) {
+		const Vertex& a=vertices.at(i);
+		const Vertex& b=vertices.at((i+1)%size);
+		n.x+=(a.y-b.y)*(a.z+b.z);
+		n.y+=(a.z-b.z)*(a.x+b.x);
+		n.z+=(a.x-b.x)*(a.y+b.y);
+		c=c+a;
+	}
+	const double length=std::sqrt(dot(n,n));
+	if(length<epsilon*epsilon)
+		return false;
+
+	n=n*(1.0/length);
+	c=c*(1.0/static_cast<double>(size));
+	plane=Plane{n,dot(n,c)};
+	return true;
+}
+
+static void flip(Plane& p)
+{
+	p.normal=p.normal*-1.0;
+	p.w=-p.w;
+}
+
+static void flip(Facet& f)
+{
+	std::reverse(f.vertices.begin(),f.vertices.end());
+	flip(f.plane);
+}
+
+enum Side {
+	Coplanar=0,
+	Front=1,
+	Back=2,
+	Spanning=3
+};
+
+static void split(const Plane& p,const Facet& f,QList<Facet>& coplanarFront,QList<Facet>& coplanarBack,QList<Facet>& front,QList<Facet>& back)
+{
+	int type=Coplanar;
+	QList<int> sides;
+	sides.reserve(f.vertices.size());
+	for(const auto& v: f.vertices) {
+		const double t=dot(p.normal,v)-p.w;
+		const int side=t<-epsilon?Back:(t>epsilon?Front:Coplanar);
+		type|=side;
+		sides.append(side);
+	}
+
+	switch(type) {
+		case Coplanar:
+			if(dot(p.normal,f.plane.normal)>0.0)
+				coplanarFront.append(f);
+			else
+				coplanarBack.append(f);
+			break;
+		case Front:
+			front.append(f);
+			break;
+		case Back:
+			back.append(f);
+			break;
+		default: {
+			Facet fs{{},f.plane};
+			Facet bs{{},f.plane};
+			const auto size=f.vertices.size();
+			for(auto i=0; i<size; ++i) {
+				const auto j=(i+1)%size;
+				const int si=sides.at(i);
+				const int sj=sides.at(j);
+				const Vertex& vi=f.vertices.at(i);
+				const Vertex& vj=f.vertices.at(j);
+				if(si!=Back)
+					fs.vertices.append(vi);
+				if(si!=Front)
+					bs.vertices.append(vi);
+				if((si|sj)==Spanning) {
+					const double t=(p.w-dot(p.normal,vi))/dot(p.normal,vj-vi);
+					const Vertex v=vi+(vj-vi)*t;
+					fs.vertices.append(v);
+					bs.vertices.append(v);
+				}
+			}
+			if(fs.vertices.size()>=3)
+				front.append(fs);
+			if(bs.vertices.size()>=3)
+				back.append(bs);
+			break;
+		}
+	}
+}
+
+/* A binary space partitioning tree of the facets of a closed mesh. The
+ * nodes are kept in a list and walked without recursion since the trees
+ * of convex meshes are as deep as they have facets. */
+class PartitionTree
+{
+public:
+	explicit PartitionTree(const QList<Facet>&);
+	void build(const QList<Facet>&);
+	void invert();
+	void clipTo(const PartitionTree&);
+	QList<Facet> clip(const QList<Facet>&) const;
+	QList<Facet> getFacets() const;
+private:
+	struct Node {
+		Plane plane;
+		QList<Facet> facets;
+		qsizetype front;
+		qsizetype back;
+	};
+	qsizetype createNode(const Plane&);
+	QList<Node> nodes;
+};
+
+PartitionTree::PartitionTree(const QList<Facet>& facets)
+{
+	build(facets);
+}
+
+qsizetype PartitionTree::createNode(const Plane& p)
+{
+	nodes.append(Node{p,{},-1,-1});
+	return nodes.size()-1;
+}
+
+void PartitionTree::build(const QList<Facet>& facets)
+{
+	if(facets.isEmpty()) return;
+	if(nodes.isEmpty())
+		createNode(facets.first().plane);
+
+	QList<QPair<qsizetype,QList<Facet>>> pending;
+	pending.append(qMakePair(0,facets));
+	while(!pending.isEmpty()) {
+		const auto [i,list]=pending.takeLast();
+		const Plane plane=nodes.at(i).plane;
+		QList<Facet> coplanar;
+		QList<Facet> front;
+		QList<Facet> back;
+		for(const auto& f: list)
+			split(plane,f,coplanar,coplanar,front,back);
+		nodes[i].facets.append(coplanar);
+
+		if(!front.isEmpty()) {
+			if(nodes.at(i).front<0) {
+				const qsizetype n=createNode(front.first().plane);
+				nodes[i].front=n;
+			}
+			pending.append(qMakePair(nodes.at(i).front,front));
+		}
+		if(!back.isEmpty()) {
+			if(nodes.at(i).back<0) {
+				const qsizetype n=createNode(back.first().plane);
+				nodes[i].back=n;
+			}
+			pending.append(qMakePair(nodes.at(i).back,back));
+		}
+	}
+}
+
+void PartitionTree::invert()
+{
+	for(auto& n: nodes) {
+		for(auto& f: n.facets)
+			flip(f);
+		flip(n.plane);
+		std::swap(n.front,n.back);
+	}
+}
+
+QList<Facet> PartitionTree::clip(const QList<Facet>& facets) const
+{
+	if(nodes.isEmpty()) return facets;
+
+	/* Facets that end up behind a leaf are inside the mesh */
+	QList<Facet> result;
+	QList<QPair<qsizetype,QList<Facet>>> pending;
+	pending.append(qMakePair(0,facets));
+	while(!pending.isEmpty()) {
+		const auto [i,list]=pending.takeLast();
+		const Node& n=nodes.at(i);
+		QList<Facet> front;
+		QList<Facet> back;
+		for(const auto& f: list)
+			split(n.plane,f,front,back,front,back);
+		if(n.front>=0)
+			pending.append(qMakePair(n.front,front));
+		else
+			result.append(front);
+		if(n.back>=0)
+			pending.append(qMakePair(n.back,back));
+	}
+	return result;
+}
+
+void PartitionTree::clipTo(const PartitionTree& other)
+{
+	for(auto& n: nodes)
+		n.facets=other.clip(n.facets);
+}
+
+QList<Facet> PartitionTree::getFacets() const
+{
+	QList<Facet> result;
+	for(const auto& n: nodes)
+		result.append(n.facets);
+	return result;
+}
+
+PreviewMesh::PreviewMesh()
+{
+}
+
+PreviewMesh::PreviewMesh(Primitive& pr)
+{
+#ifdef USE_CGAL
+	auto* cp=dynamic_cast<CGALPrimitive*>(&pr);
+	if(cp && cp->getCGALPolygons().isEmpty()) {
+		appendPolyhedron(*cp);
+		return;
+	}
+	if(cp) {
+		Part p{{},cp->getType()==PrimitiveTypes::Volume,{},{}};
+		for(CGALPolygon* pg: cp->getCGALPolygons())
+			appendFacet(p,pg->getPoints());
+		appendPart(p);
+		return;
+	}
+#endif
+	Part p{{},pr.getType()==PrimitiveTypes::Volume,{},{}};
+	for(Polygon* pg: pr.getPolygons())
+		appendFacet(p,pg->getPoints());
+	appendPart(p);
+}
+
+#ifdef USE_CGAL
+void PreviewMesh::appendPolyhedron(CGALPrimitive& cp)
+{
+	if(cp.isFullyDimentional()) {
+		CGAL::Polyhedron3* poly=cp.getPolyhedron();
+		Part p{{},true,{},{}};
+		for(auto fi=poly->facets_begin(); fi!=poly->facets_end(); ++fi) {
+			QList<Point> points;
+			auto hc=fi->facet_begin();
+			do {
+				points.append(hc->vertex()->point());
+			} while(++hc!=fi->facet_begin());
+			appendFacet(p,points);
+		}
+		delete poly;
+		appendPart(p);
+		return;
+	}
+
+	/* Surfaces are shown by the polygons of their boundary */
+	CGALExplorer explorer(&cp);
+	CGALPrimitive* boundary=explorer.getPrimitive();
+	if(!boundary) return;
+	Part p{{},false,{},{}};
+	for(CGALPolygon* pg: boundary->getCGALPolygons())
+		appendFacet(p,pg->getPoints());
+	delete boundary;
+	appendPart(p);
+}
+#endif
+
+void PreviewMesh::appendFacet(Part& p,const QList<Point>& points)
+{
+	Facet f;
+	for(const auto& pt: points)
+		f.vertices.append(toVertex(pt));
+	if(f.vertices.size()>=3 && createPlane(f.vertices,f.plane))
+		p.facets.append(f);
+}
+
+void PreviewMesh::appendPart(Part& p)
+{
+	if(p.facets.isEmpty()) return;
+
+	/* The facets of primitives are not always wound the same way, so make
+	 * them face outwards by the sign of the volume they enclose */
+	if(p.closed) {
+		double volume=0.0;
+		for(const auto& f: std::as_const(p.facets)) {
+			const Vertex& v0=f.vertices.at(0);
+			for(auto i=1; i+1<f.vertices.size(); ++i)
+				volume+=dot(v0,cross(f.vertices.at(i),f.vertices.at(i+1)));
+		}
+		if(volume<0.0) {
+			for(auto& f: p.facets)
+				flip(f);
+		}
+	}
+	updateBounds(p);
+	parts.append(p);
+}
+
+void PreviewMesh::updateBounds(Part& p)
+{
+	bool first=true;
+	for(const auto& f: std::as_const(p.facets)) {
+		for(const auto& v: f.vertices) {
+			if(first) {
+				p.lower=v;
+				p.upper=v;
+				first=false;
+				continue;
+			}
+			p.lower=Vertex{std::min(p.lower.x,v.x),std::min(p.lower.y,v.y),std::min(p.lower.z,v.z)};
+			p.upper=Vertex{std::max(p.upper.x,v.x),std::max(p.upper.y,v.y),std::max(p.upper.z,v.z)};
+		}
+	}
+}
+
+bool PreviewMesh::overlaps(const Part& a,const Part& b)
+{
+	return a.lower.x<=b.upper.x+epsilon && b.lower.x<=a.upper.x+epsilon &&
+		   a.lower.y<=b.upper.y+epsilon && b.lower.y<=a.upper.y+epsilon &&
+		   a.lower.z<=b.upper.z+epsilon && b.lower.z<=a.upper.z+epsilon;
+}
+
+PreviewMesh::Part PreviewMesh::difference(const Part& a,const Part& b)
+{
+	PartitionTree ta(a.facets);
+	PartitionTree tb(b.facets);
+	ta.invert();
+	ta.clipTo(tb);
+	tb.clipTo(ta);
+	tb.invert();
+	tb.clipTo(ta);
+	tb.invert();
+	ta.build(tb.getFacets());
+	ta.invert();
+	return Part{ta.getFacets(),true,a.lower,a.upper};
+}
+
+PreviewMesh::Part PreviewMesh::intersection(const Part& a,const Part& b)
+{
+	PartitionTree ta(a.facets);
+	PartitionTree tb(b.facets);
+	ta.invert();
+	tb.clipTo(ta);
+	tb.invert();
+	ta.clipTo(tb);
+	tb.clipTo(ta);
+	ta.build(tb.getFacets());
+	ta.invert();
+	Part p{ta.getFacets(),true,{},{}};
+	updateBounds(p);
+	return p;
+}
+
+bool PreviewMesh::isEmpty() const
+{
+	for(const auto& p: parts)
+		if(!p.facets.isEmpty())
+			return false;
+	return true;
+}
+
+void PreviewMesh::group(const PreviewMesh& that)
+{
+	parts.append(that.parts);
+}
+
+void PreviewMesh::difference(const PreviewMesh& that)
+{
+	/* Taking away a union is taking away each of its parts in turn */
+	for(auto& a: parts) {
+		if(!a.closed) continue;
+		for(const auto& b: that.parts) {
+			if(b.closed && overlaps(a,b))
+				a=difference(a,b);
+		}
+	}
+}
+
+void PreviewMesh::intersection(const PreviewMesh& that)
+{
+	QList<Part> result;
+	for(const auto& a: std::as_const(parts)) {
+		if(!a.closed) {
+			result.append(a);
+			continue;
+		}
+		for(const auto& b: that.parts) {
+			if(!b.closed || !overlaps(a,b)) continue;
+			const Part& p=intersection(a,b);
+			if(!p.facets.isEmpty())
+				result.append(p);
+		}
+	}
+	parts=result;
+}
+
+void PreviewMesh::symmetricDifference(const PreviewMesh& that)
+{
+	PreviewMesh other=that;
+	other.difference(*this);
+	difference(that);
+	group(other);
+}
+
+void PreviewMesh::transform(TransformMatrix* matrix)
+{
+	if(!matrix) return;
+
+	double m[3][4];
+#ifdef USE_CGAL
+	const CGAL::AffTransformation3& t=matrix->getTransform();
+	for(auto i=0; i<3; ++i)
+		for(auto j=0; j<4; ++j)
+			m[i][j]=CGAL::to_double(t.m(i,j));
+#else
+	const auto& t=matrix->getValues();
+	for(auto i=0; i<3; ++i)
+		for(auto j=0; j<4; ++j)
+			m[i][j]=t(i,j);
+#endif
+
+	/* Mirroring turns the facets inside out unless they are reversed */
+	const double determinant=
+		m[0][0]*(m[1][1]*m[2][2]-m[1][2]*m[2][1])-
+		m[0][1]*(m[1][0]*m[2][2]-m[1][2]*m[2][0])+
+		m[0][2]*(m[1][0]*m[2][1]-m[1][1]*m[2][0]);
+
+	for(auto& p: parts) {
+		QList<Facet> facets;
+		for(auto f: std::as_const(p.facets)) {
+			for(auto& v: f.vertices)
+				v=Vertex{
+					m[0][0]*v.x+m[0][1]*v.y+m[0][2]*v.z+m[0][3],
+					m[1][0]*v.x+m[1][1]*v.y+m[1][2]*v.z+m[1][3],
+					m[2][0]*v.x+m[2][1]*v.y+m[2][2]*v.z+m[2][3]
+				};
+			if(determinant<0.0)
+				std::reverse(f.vertices.begin(),f.vertices.end());
+			if(createPlane(f.vertices,f.plane))
+				facets.append(f);
+		}
+		p.facets=facets;
+		updateBounds(p);
+	}
+}
+
+Primitive* PreviewMesh::createPrimitive() const
+{
+	auto* pr=new Polyhedron();
+	pr->setType(PrimitiveTypes::Volume);
+	Polygon::size_type index=0;
+	for(const auto& p: parts) {
+		for(const auto& f: p.facets) {
+			Polygon& pg=pr->createPolygon();
+			for(const auto& v: f.vertices) {
+				pr->createVertex(Point(v.x,v.y,v.z));
+				pg.append(index++);
+			}
+		}
+	}
+	return pr;
+}
@@ -0,0 +1,82 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PREVIEWMESH_H
+#define PREVIEWMESH_H
+
+#include "point.h"
+#include "primitive.h"
+#include "transformmatrix.h"
+#include <QList>
+
+/**
+ * @brief A floating point boundary mesh that is used to preview a design
+ * without evaluating exact booleans. Differences and intersections of
+ * closed meshes are approximated by clipping them against binary space
+ * partitioning trees of each other.
+ */
+class PreviewMesh
+{
+public:
+	struct Vertex {
+		double x;
+		double y;
+		double z;
+	};
+	struct Plane {
+		Vertex normal;
+		double w;
+	};
+	struct Facet {
+		QList<Vertex> vertices;
+		Plane plane;
+	};
+
+	PreviewMesh();
+	explicit PreviewMesh(Primitive&);
+	bool isEmpty() const;
+	void group(const PreviewMesh&);
+	void difference(const PreviewMesh&);
+	void intersection(const PreviewMesh&);
+	void symmetricDifference(const PreviewMesh&);
+	void transform(TransformMatrix*);
+	Primitive* createPrimitive() const;
+private:
+	/* The parts of a union are kept apart since both difference and
+	 * intersection distribute over them, so unions never have to be
+	 * evaluated. Only the parts that are closed have an inside. */
+	struct Part {
+		QList<Facet> facets;
+		bool closed;
+		Vertex lower;
+		Vertex upper;
+	};
+	static void appendFacet(Part&,const QList<Point>&);
+	static void updateBounds(Part&);
+	static bool overlaps(const Part&,const Part&);
+	static Part difference(const Part&,const Part&);
+	static Part intersection(const Part&,const Part&);
+	void appendPart(Part&);
+#ifdef USE_CGAL
+	void appendPolyhedron(class CGALPrimitive&);
+#endif
+
+	QList<Part> parts;
+};
+
+#endif // PREVIEWMESH_H
@@ -0,0 +1,193 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "previewrenderer.h"
+#include "displaylist.h"
+#include "preferences.h"
+#include <limits>
+
+PreviewRenderer::PreviewRenderer(Reporter& r,const Primitive& pr) :
+	reporter(r),
+	edgeSize(0.0F),
+	displayList(nullptr)
+{
+	loadPreferences();
+	descendChildren(pr);
+}
+
+PreviewRenderer::~PreviewRenderer()
+{
+	deleteDisplayLists();
+}
+
+static QVector3D toVector(const Point& p)
+{
+#ifdef USE_CGAL
+	return QVector3D(static_cast<float>(to_double(p.x())),static_cast<float>(to_double(p.y())),static_cast<float>(to_double(p.z())));
+#else
+	return QVector3D(static_cast<float>(p.x()),static_cast<float>(p.y()),static_cast<float>(p.z()));
+#endif
+}
+
+void PreviewRenderer::descendChildren(const Primitive& pr)
+{
+	for(Polygon* pg: pr.getPolygons()) {
+		QList<QVector3D> points;
+		for(const auto& p: pg->getPoints())
+			points.append(toVector(p));
+		const auto size=points.size();
+		if(size<3) continue;
+
+		/* Newell's method, since the facets of clipped meshes can be
+		 * slivers for which the first few vertices are nearly in line */
+		QVector3D normal;
+		for(auto i=0; i<size; ++i) {
+			const QVector3D& a=points.at(i);
+			const QVector3D& b=points.at((i+1)%size);
+			normal+=QVector3D((a.y()-b.y())*(a.z()+b.z()),(a.z()-b.z())*(a.x()+b.x()),(a.x()-b.x())*(a.y()+b.y()));
+		}
+		normal.normalize();
+
+		for(auto i=1; i+1<size; ++i) {
+			triangles.append(points.at(0));
+			triangles.append(points.at(i));
+			triangles.append(points.at(i+1));
+			normals.append(normal);
+		}
+		for(auto i=0; i<size; ++i) {
+			edges.append(points.at(i));
+			edges.append(points.at((i+1)%size));
+		}
+	}
+
+	for(Primitive* c: pr.getChildren())
+		descendChildren(*c);
+}
+
+void PreviewRenderer::loadPreferences()
+{
+	auto& p=Preferences::getInstance();
+	facetColor=p.getFacetColor();
+	edgeColor=p.getEdgeColor();
+	edgeSize=p.getEdgeSize();
+}
+
+void PreviewRenderer::desaturate(QColor& c)
+{
+	c=QColor::fromHsv(c.hue(),0,c.value());
+}
+
+void PreviewRenderer::fillDisplayLists(QOpenGLFunctions_1_0& f)
+{
+	f.glNewList(displayList->getId(0),GL_COMPILE);
+	if(edgeSize>0.0F) {
+		f.glLineWidth(edgeSize);
+		f.glColor3ub(edgeColor.red(),edgeColor.green(),edgeColor.blue());
+		f.glBegin(GL_LINES);
+		for(const auto& v: std::as_const(edges))
+			f.glVertex3f(v.x(),v.y(),v.z());
+		f.glEnd();
+	}
+	f.glEndList();
+
+	f.glNewList(displayList->getId(1),GL_COMPILE);
+	f.glColor3ub(facetColor.red(),facetColor.green(),facetColor.blue());
+	f.glBegin(GL_TRIANGLES);
+	for(auto i=0; i<triangles.size(); ++i) {
+		if(i%3==0) {
+			const QVector3D& n=normals.at(i/3);
+			f.glNormal3f(n.x(),n.y(),n.z());
+		}
+		const QVector3D& v=triangles.at(i);
+		f.glVertex3f(v.x(),v.y(),v.z());
+	}
+	f.glEnd();
+	f.glEndList();
+}
+
+void PreviewRenderer::deleteDisplayLists()
+{
+	delete displayList;
+	displayList=nullptr;
+}
+
+void PreviewRenderer::paint(QOpenGLFunctions_1_0& f,bool skeleton,bool showedges)
+{
+	if(!displayList) {
+		displayList=new DisplayList(f,2);
+		fillDisplayLists(f);
+	}
+
+	if(!skeleton)
+		f.glCallList(displayList->getId(1));
+	if(skeleton||showedges) {
+		f.glDisable(GL_LIGHTING);
+		f.glCallList(displayList->getId(0));
+		f.glEnable(GL_LIGHTING);
+	}
+}
+
+void PreviewRenderer::locate(const QVector3D& s,const QVector3D& t)
+{
+	/* The preview has no exact geometry, so pick the nearest of its
+	 * triangles along the ray using the Moller-Trumbore intersection */
+	const QVector3D& direction=t-s;
+	float nearest=std::numeric_limits<float>::infinity();
+	for(auto i=0; i+2<triangles.size(); i+=3) {
+		const QVector3D& a=triangles.at(i);
+		const QVector3D& e1=triangles.at(i+1)-a;
+		const QVector3D& e2=triangles.at(i+2)-a;
+		const QVector3D& p=QVector3D::crossProduct(direction,e2);
+		const float det=QVector3D::dotProduct(e1,p);
+		if(qFuzzyIsNull(det)) continue;
+
+		const QVector3D& o=s-a;
+		const float u=QVector3D::dotProduct(o,p)/det;
+		if(u<0.0F||u>1.0F) continue;
+		const QVector3D& q=QVector3D::crossProduct(o,e1);
+		const float v=QVector3D::dotProduct(direction,q)/det;
+		if(v<0.0F||u+v>1.0F) continue;
+		const float d=QVector3D::dotProduct(e2,q)/det;
+		if(d>=0.0F && d<nearest)
+			nearest=d;
+	}
+
+	Point p;
+	if(nearest!=std::numeric_limits<float>::infinity()) {
+		const QVector3D& h=s+direction*nearest;
+		p=Point(static_cast<double>(h.x()),static_cast<double>(h.y()),static_cast<double>(h.z()));
+	}
+	reporter.reportMessage(to_string(p));
+}
+
+void PreviewRenderer::preferencesUpdated()
+{
+	loadPreferences();
+	deleteDisplayLists();
+}
+
+void PreviewRenderer::setCompiling(bool value)
+{
+	if(value) {
+		desaturate(facetColor);
+		desaturate(edgeColor);
+	} else {
+		loadPreferences();
+	}
+	deleteDisplayLists();
+}
@@ -0,0 +1,60 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PREVIEWRENDERER_H
+#define PREVIEWRENDERER_H
+
+#include "primitive.h"
+#include "renderer.h"
+#include "reporter.h"
+#include <QColor>
+#include <QList>
+
+/**
+ * @brief Draws the floating point meshes of a preview. The facets are
+ * drawn as fans of triangles, which suits the convex facets of primitives
+ * and of the meshes clipped from them.
+ */
+class PreviewRenderer : public Renderer
+{
+	Q_DISABLE_COPY_MOVE(PreviewRenderer)
+public:
+	PreviewRenderer(Reporter&,const Primitive&);
+	~PreviewRenderer() override;
+	void paint(QOpenGLFunctions_1_0&,bool,bool) override;
+	void locate(const QVector3D&,const QVector3D&) override;
+	void preferencesUpdated() override;
+	void setCompiling(bool) override;
+private:
+	void descendChildren(const Primitive&);
+	void loadPreferences();
+	void fillDisplayLists(QOpenGLFunctions_1_0&);
+	void deleteDisplayLists();
+	static void desaturate(QColor&);
+
+	Reporter& reporter;
+	QList<QVector3D> triangles;
+	QList<QVector3D> normals;
+	QList<QVector3D> edges;
+	QColor facetColor;
+	QColor edgeColor;
+	float edgeSize;
+	class DisplayList* displayList;
+};
+
+#endif // PREVIEWRENDERER_H
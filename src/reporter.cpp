@@ -16,8 +16,11 @@
  *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "reporter.h"
+#include <QMutexLocker>
 #include <contrib/qtcompat.h>
 
+static thread_local Reporter* active=nullptr;
+
 Reporter::Reporter(QTextStream& s) :
 	Reporter(s,s)
 {
@@ -28,8 +31,21 @@ Reporter::Reporter(QTextStream& o, QTextStream& s):
 	messages(s),
 	timer(nullptr),
 	returnCode(EXIT_FAILURE),
-	positionOffset(0)
+	positionOffset(0),
+	shared(false)
+{
+}
+
+Reporter& Reporter::target()
 {
+	/* The builtins are created once for the whole process, so their
+	 * reports go to the reporter of the evaluation that uses them */
+	return (shared&&active)?*active:*this;
+}
+
+const Reporter& Reporter::target() const
+{
+	return (shared&&active)?*active:*this;
 }
 
 void Reporter::startTiming()
@@ -60,6 +76,7 @@ void Reporter::reportTiming(const QString& what)
 
 void Reporter::reportTimings()
 {
+	const QMutexLocker locker(&mutex);
 	for(auto& m: std::as_const(timings))
 		messages << m << Qt::endl;
 	timings.clear();
@@ -67,37 +84,49 @@ void Reporter::reportTimings()
 
 void Reporter::reportSyntaxError(const AbstractTokenBuilder& t,const QString& msg)
 {
+	Reporter& r=target();
+	const QMutexLocker locker(&r.mutex);
 	const QString& text=t.getToken();
-	const int pos=t.getPosition()+positionOffset;
+	const int pos=t.getPosition()+r.positionOffset;
 	const int line=t.getLineNumber();
-	messages << tr("Line %1: %2 at character %3: '%4'").arg(line).arg(msg).arg(pos).arg(text) << Qt::endl;
+	r.messages << tr("Line %1: %2 at character %3: '%4'").arg(line).arg(msg).arg(pos).arg(text) << Qt::endl;
 }
 
 void Reporter::reportLexicalError(const AbstractTokenBuilder& t,const QString& text)
 {
-	const int pos=t.getPosition()+positionOffset;
+	Reporter& r=target();
+	const QMutexLocker locker(&r.mutex);
+	const int pos=t.getPosition()+r.positionOffset;
 	const int line=t.getLineNumber();
-	messages << tr("Line %1: illegal token at character %2: '%3'").arg(line).arg(pos).arg(text) << Qt::endl;
+	r.messages << tr("Line %1: illegal token at character %2: '%3'").arg(line).arg(pos).arg(text) << Qt::endl;
 }
 
 void Reporter::reportFileMissingError(const QString& fullpath)
 {
-	messages << tr("Can't open input file '%1'").arg(fullpath) << Qt::endl;
+	Reporter& r=target();
+	const QMutexLocker locker(&r.mutex);
+	r.messages << tr("Can't open input file '%1'").arg(fullpath) << Qt::endl;
 }
 
 void Reporter::reportTesselationError(const QString& text)
 {
-	messages << tr("Tessellation Error: %1").arg(text) << Qt::endl;
+	Reporter& r=target();
+	const QMutexLocker locker(&r.mutex);
+	r.messages << tr("Tessellation Error: %1").arg(text) << Qt::endl;
 }
 
 void Reporter::reportWarning(const QString& warning)
 {
-	messages << tr("Warning: %1").arg(warning) << Qt::endl;
+	Reporter& r=target();
+	const QMutexLocker locker(&r.mutex);
+	r.messages << tr("Warning: %1").arg(warning) << Qt::endl;
 }
 
 void Reporter::reportMessage(const QString& msg)
 {
-	messages << msg << Qt::endl;
+	Reporter& r=target();
+	const QMutexLocker locker(&r.mutex);
+	r.messages << msg << Qt::endl;
 }
 
 void Reporter::reportException()
@@ -107,20 +136,50 @@ void Reporter::reportException()
 
 void Reporter::reportException(const QString& ex)
 {
-	messages << tr("Exception: %1").arg(ex) << Qt::endl;
+	Reporter& r=target();
+	const QMutexLocker locker(&r.mutex);
+	r.messages << tr("Exception: %1").arg(ex) << Qt::endl;
 }
 
 void Reporter::setReturnCode(int code)
 {
-	returnCode=code;
+	target().returnCode=code;
 }
 
 bool Reporter::getReturnCode() const
 {
-	return returnCode;
+	return target().returnCode;
 }
 
 void Reporter::setPositionOffset(int o)
 {
 	positionOffset=o;
 }
+
+void Reporter::reportMessages(const QString& msgs)
+{
+	const QMutexLocker locker(&mutex);
+	messages << msgs;
+	messages.flush();
+}
+
+void Reporter::setShared(bool s)
+{
+	shared=s;
+}
+
+QTextStream& Reporter::getOutput()
+{
+	return target().output;
+}
+
+Reporter::Scope::Scope(Reporter& r) :
+	previous(active)
+{
+	active=&r;
+}
+
+Reporter::Scope::~Scope()
+{
+	active=previous;
+}
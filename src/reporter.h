@@ -22,6 +22,7 @@
 #include "abstracttokenbuilder.h"
 #include <QCoreApplication>
 #include <QElapsedTimer>
+#include <QMutex>
 #include <QTextStream>
 
 class Reporter
@@ -45,13 +46,39 @@ public:
 	void setReturnCode(int);
 	bool getReturnCode() const;
 	void setPositionOffset(int);
+	/**
+	 * @brief Append messages that were collected elsewhere, such as those of
+	 * a batch job, without interleaving them with other reports.
+	 */
+	void reportMessages(const QString&);
+	/**
+	 * @brief A shared reporter, such as the one the builtins were created
+	 * with, passes its reports on to the reporter of the innermost Scope
+	 * of the calling thread.
+	 */
+	void setShared(bool);
+	QTextStream& getOutput();
 	QTextStream& output;
 	QTextStream& messages;
+
+	class Scope
+	{
+		Q_DISABLE_COPY_MOVE(Scope)
+	public:
+		explicit Scope(Reporter&);
+		~Scope();
+	private:
+		Reporter* previous;
+	};
 private:
+	Reporter& target();
+	const Reporter& target() const;
 	QElapsedTimer* timer;
 	QList<QString> timings;
+	QMutex mutex;
 	int returnCode;
 	int positionOffset;
+	bool shared;
 };
 
 #endif // REPORTER_H
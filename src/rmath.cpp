@@ -22,7 +22,7 @@
 #ifdef USE_CGAL
 #include <mpfr.h>
 #endif
-#include "preferences.h"
+#include "evaluationsettings.h"
 
 #ifndef USE_CGAL
 /* Tau is a more useful constant than PI and is defined as 2*PI
@@ -56,7 +56,7 @@ decimal r_round_preference(mpfr_t& a,bool round)
 decimal r_round_preference(const decimal& a,bool round)
 {
 	if(round) {
-		auto& p=Preferences::getInstance();
+		const auto& p=EvaluationSettings::current();
 		switch(p.getFunctionRounding()) {
 			case Rounding::Decimal:
 				return r_round(a,p.getDecimalPlaces());
@@ -82,7 +82,7 @@ decimal r_pi(bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_const_pi(m,MPFR_RNDN);
 	return r_round_preference(m,round);
 #else
@@ -104,7 +104,7 @@ decimal r_pow(const decimal& a,const decimal& e,bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_t o;
@@ -123,7 +123,7 @@ decimal r_round(const decimal& a)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_round(m,n);
@@ -138,11 +138,13 @@ decimal r_round(const decimal& a,int places)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
-	mpfr_init_set_si(n,10,MPFR_RNDN);
+	init_mpfr(n);
+	mpfr_set_si(n,10,MPFR_RNDN);
 	mpfr_t o;
-	mpfr_init_set_si(o,places,MPFR_RNDN);
+	init_mpfr(o);
+	mpfr_set_si(o,places,MPFR_RNDN);
 	mpfr_pow(m,n,o,MPFR_RNDN);
 	mpfr_clear(n);
 	mpfr_clear(o);
@@ -157,7 +159,7 @@ decimal r_sin(const decimal& a,bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_sin(m,n,MPFR_RNDN);
@@ -172,7 +174,7 @@ decimal r_cos(const decimal& a,bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_cos(m,n,MPFR_RNDN);
@@ -187,7 +189,7 @@ decimal r_tan(const decimal& a,bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_tan(m,n,MPFR_RNDN);
@@ -238,7 +240,7 @@ decimal r_sqrt(const decimal& a,bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_sqrt(m,n,MPFR_RNDN);
@@ -253,7 +255,7 @@ decimal r_cbrt(const decimal& a,bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_cbrt(m,n,MPFR_RNDN);
@@ -268,7 +270,7 @@ decimal r_mod(const decimal& a,const decimal& b)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_t o;
@@ -295,7 +297,7 @@ decimal r_acos(const decimal& a,bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_acos(m,n,MPFR_RNDN);
@@ -315,7 +317,7 @@ decimal r_asin(const decimal& a,bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_asin(m,n,MPFR_RNDN);
@@ -335,7 +337,7 @@ decimal r_atan2(const decimal& a,const decimal& b,bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_t o;
@@ -358,7 +360,7 @@ decimal r_atan(const decimal& a,bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_atan(m,n,MPFR_RNDN);
@@ -378,7 +380,7 @@ decimal r_cosh(const decimal& a,bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_cosh(m,n,MPFR_RNDN);
@@ -398,7 +400,7 @@ decimal r_sinh(const decimal& a,bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_sinh(m,n,MPFR_RNDN);
@@ -418,7 +420,7 @@ decimal r_tanh(const decimal& a,bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_tanh(m,n,MPFR_RNDN);
@@ -456,7 +458,7 @@ decimal r_ceil(const decimal& a)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_ceil(m,n);
@@ -471,7 +473,7 @@ decimal r_floor(const decimal& a)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_floor(m,n);
@@ -486,7 +488,7 @@ decimal r_exp(const decimal& a,bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_exp(m,n,MPFR_RNDN);
@@ -501,7 +503,7 @@ decimal r_log(const decimal& a,bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_log(m,n,MPFR_RNDN);
@@ -516,7 +518,7 @@ decimal r_log10(const decimal& a,bool round)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_t n;
 	to_mpfr(n,a);
 	mpfr_log10(m,n,MPFR_RNDN);
@@ -557,7 +559,7 @@ decimal r_rand(const decimal& min,const decimal& max)
 {
 #ifdef USE_CGAL
 	mpfr_t m;
-	mpfr_init(m);
+	init_mpfr(m);
 	mpfr_urandom(m,state,MPFR_RNDN);
 	return r_round_preference((min>max)?to_decimal(m)*(min-max)+max:to_decimal(m)*(max-min)+min,true);
 #else
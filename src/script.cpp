@@ -23,7 +23,9 @@
 
 extern int parserparse(AbstractSyntaxTreeBuilder&);
 
-Script::Script(Reporter& r) : reporter(r)
+Script::Script(Reporter& r) :
+	reporter(r),
+	errors(false)
 {
 }
 
@@ -38,13 +40,14 @@ void Script::parse(const QString& input)
 	TokenBuilder t(reporter,input);
 	SyntaxTreeBuilder b(reporter,*this,t);
 
-	parserparse(b);
+	errors=parserparse(b)!=0||t.hasErrors();
 }
 
 void Script::parse(const QFileInfo& info)
 {
 	if(!info.exists()) {
 		reporter.reportFileMissingError(info.absoluteFilePath());
+		errors=true;
 		return;
 	}
 
@@ -52,7 +55,7 @@ void Script::parse(const QFileInfo& info)
 	SyntaxTreeBuilder b(reporter,*this,t);
 	b.buildFileLocation(info.absoluteDir());
 
-	parserparse(b);
+	errors=parserparse(b)!=0||t.hasErrors();
 }
 
 bool Script::isEmpty()
@@ -60,6 +63,11 @@ bool Script::isEmpty()
 	return declarations.isEmpty();
 }
 
+bool Script::hasErrors() const
+{
+	return errors;
+}
+
 void Script::setDeclarations(const QList<Declaration*>& decls)
 {
 	declarations = decls;
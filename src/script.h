@@ -36,6 +36,10 @@ public:
 	void parse(const QFileInfo&);
 
 	bool isEmpty();
+	/**
+	 * @brief Whether errors were reported while the script was parsed.
+	 */
+	bool hasErrors() const;
 	void setDeclarations(const QList<Declaration*>&);
 	const QList<Declaration*>& getDeclarations() const override;
 	void addDeclaration(Declaration*);
@@ -48,6 +52,7 @@ private:
 	QList<Declaration*> declarations;
 	QDir fileLocation;
 	Reporter& reporter;
+	bool errors;
 };
 
 #endif // SCRIPT_H
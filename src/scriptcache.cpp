@@ -0,0 +1,125 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scriptcache.h"
+#include <QMutexLocker>
+#include <contrib/qtcompat.h>
+
+ScriptCache::ScriptCache() :
+	disabled(true)
+{
+}
+
+ScriptCache::~ScriptCache()
+{
+	flushCaches();
+	qDeleteAll(retired);
+	retired.clear();
+}
+
+ScriptCache& ScriptCache::getInstance()
+{
+	static ScriptCache instance;
+	return instance;
+}
+
+Script* ScriptCache::fetch(const QFileInfo& info,Reporter& r)
+{
+	const QString& path=info.absoluteFilePath();
+	const QDateTime& modified=info.lastModified();
+	{
+		const QMutexLocker locker(&mutex);
+		if(disabled)
+			return nullptr;
+		const auto& it=scripts.constFind(path);
+		if(it!=scripts.constEnd() && it->modified==modified) {
+			++users[it->script];
+			return it->script;
+		}
+	}
+
+	/* Parse outside of the lock so that different files can be parsed
+	 * concurrently */
+	auto* s=new Script(r);
+	s->parse(info);
+
+	const QMutexLocker locker(&mutex);
+	if(s->hasErrors()) {
+		/* The errors are only reported by the parse, so a script that
+		 * failed is not cached and is deleted once it is released */
+		++users[s];
+		retired.insert(s);
+		return s;
+	}
+	const auto& it=scripts.constFind(path);
+	if(it!=scripts.constEnd()) {
+		if(it->modified==modified) {
+			delete s;
+			++users[it->script];
+			return it->script;
+		}
+		retire(it->script);
+	}
+	scripts.insert(path,Entry{s,modified});
+	++users[s];
+	return s;
+}
+
+void ScriptCache::release(Script* s)
+{
+	const QMutexLocker locker(&mutex);
+	auto it=users.find(s);
+	if(it==users.end() || --it.value()>0)
+		return;
+
+	users.erase(it);
+	if(retired.remove(s))
+		delete s;
+}
+
+void ScriptCache::retire(Script* s)
+{
+	/* A previous version of the script may still be in use by an
+	 * evaluation, in which case it is deleted when that releases it */
+	if(users.contains(s)) {
+		retired.insert(s);
+		return;
+	}
+	delete s;
+}
+
+void ScriptCache::flushCaches()
+{
+	const QMutexLocker locker(&mutex);
+	for(const auto& e: std::as_const(scripts))
+		retire(e.script);
+	scripts.clear();
+}
+
+void ScriptCache::disableCaches()
+{
+	flushCaches();
+	const QMutexLocker locker(&mutex);
+	disabled=true;
+}
+
+void ScriptCache::enableCaches()
+{
+	const QMutexLocker locker(&mutex);
+	disabled=false;
+}
@@ -0,0 +1,64 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCRIPTCACHE_H
+#define SCRIPTCACHE_H
+
+#include "reporter.h"
+#include "script.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+
+class ScriptCache
+{
+	Q_DISABLE_COPY_MOVE(ScriptCache)
+public:
+	static ScriptCache& getInstance();
+	/**
+	 * @brief Fetch the parsed script for the given file.
+	 * @return The cached script, which remains owned by the cache and must
+	 * be released once the evaluation is done with it, or nullptr when the
+	 * cache is disabled.
+	 */
+	Script* fetch(const QFileInfo&,Reporter&);
+	/**
+	 * @brief Release a script returned by fetch.
+	 */
+	void release(Script*);
+	void flushCaches();
+	void disableCaches();
+	void enableCaches();
+private:
+	ScriptCache();
+	~ScriptCache();
+	struct Entry {
+		Script* script;
+		QDateTime modified;
+	};
+	void retire(Script*);
+	QHash<QString,Entry> scripts;
+	QHash<Script*,int> users;
+	QSet<Script*> retired;
+	QMutex mutex;
+	bool disabled;
+};
+
+#endif // SCRIPTCACHE_H
@@ -0,0 +1,242 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "server.h"
+#include "builtincreator.h"
+#include "cachemanager.h"
+#include "onceonly.h"
+#include "scriptcache.h"
+#include "worker.h"
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QRegularExpression>
+#include <QTemporaryFile>
+
+static constexpr int chunkSize=64*1024;
+
+Server::Server(Reporter& r) : Strategy(r)
+{
+}
+
+void Server::setup(const QString& n)
+{
+	serverName=n;
+}
+
+int Server::evaluate()
+{
+	QLocalServer server;
+	QLocalServer::removeServer(serverName);
+	if(!server.listen(serverName)) {
+		reporter.reportWarning(tr("unable to listen on '%1': %2").arg(serverName,server.errorString()));
+		return EXIT_FAILURE;
+	}
+
+	/* The builtins hold on to the reporter they were created with, so make
+	 * sure they are created with ours rather than that of the first request */
+	BuiltinCreator::getInstance(reporter);
+
+	/* Keeping parsed scripts and evaluated geometry between requests is the
+	 * whole point of the server, so the caches are always enabled here */
+	auto& cm=CacheManager::getInstance();
+	cm.enableCaches();
+	auto& sc=ScriptCache::getInstance();
+	sc.enableCaches();
+
+	reporter.reportMessage(tr("Listening on %1").arg(server.fullServerName()));
+	output.flush();
+
+	bool running=true;
+	while(running && server.waitForNewConnection(-1)) {
+		QLocalSocket* socket=server.nextPendingConnection();
+		if(!socket)
+			continue;
+		/* One request is handled per connection, closing the connection
+		 * marks the end of the reply */
+		running=handleRequest(*socket);
+		socket->disconnectFromServer();
+		delete socket;
+	}
+
+	sc.disableCaches();
+	cm.disableCaches();
+	return EXIT_SUCCESS;
+}
+
+bool Server::handleRequest(QLocalSocket& socket)
+{
+	while(!socket.canReadLine())
+		if(!socket.waitForReadyRead(-1))
+			return true;
+
+	/* Each request is a single line containing a JSON object, the reply is
+	 * a single line JSON header followed by 'size' bytes of exported data */
+	const QByteArray& line=socket.readLine();
+	QJsonParseError error;
+	const QJsonDocument& doc=QJsonDocument::fromJson(line,&error);
+	if(!doc.isObject()) {
+		QJsonObject reply;
+		reply.insert("status","error");
+		reply.insert("messages",error.errorString());
+		reply.insert("size",0);
+		writeAll(socket,QJsonDocument(reply).toJson(QJsonDocument::Compact)+'\n');
+		return true;
+	}
+
+	const QJsonObject& request=doc.object();
+	if(request.value("quit").toBool()) {
+		reporter.reportMessage(tr("Shutting down"));
+		return false;
+	}
+
+	compile(request,socket);
+	return true;
+}
+
+bool Server::getOverrides(const QJsonObject& request,QString& overrides,QString& error)
+{
+	/* Parameters are passed to the script as assignments which replace the
+	 * global assignments of the same name, so the names must be plain
+	 * identifiers and the values literals for nothing else to be run */
+	static const QRegularExpression identifier("^[a-zA-Z_][a-zA-Z0-9_]*$");
+	static const QStringList keywords {
+		"module","function","true","false","undef","const","param",
+		"if","as","else","for","return"
+	};
+	const QJsonObject& params=request.value("parameters").toObject();
+	for(auto it=params.constBegin(); it!=params.constEnd(); ++it) {
+		const QString& name=it.key();
+		if(!identifier.match(name).hasMatch() || keywords.contains(name)) {
+			error=tr("'%1' is not a valid parameter name").arg(name);
+			return false;
+		}
+		QString value;
+		if(!appendValue(it.value(),value)) {
+			error=tr("parameter '%1' has an unsupported value").arg(name);
+			return false;
+		}
+		overrides.append(QString("%1=%2;").arg(name,value));
+	}
+	return true;
+}
+
+bool Server::validFormat(const QString& format)
+{
+	/* The format becomes the suffix of the temporary file name, so only
+	 * the formats that can be exported are accepted */
+	static const QStringList formats {
+		"stl","off","obj","wrl","amf","3mf","csg","nef","svg","png","jpg"
+	};
+	return formats.contains(format);
+}
+
+bool Server::appendValue(const QJsonValue& v,QString& value)
+{
+	if(v.isDouble()) {
+		value.append(QString::number(v.toDouble(),'g',17));
+	} else if(v.isBool()) {
+		value.append(v.toBool()?"true":"false");
+	} else if(v.isNull()) {
+		value.append("undef");
+	} else if(v.isString()) {
+		QString text=v.toString();
+		text.replace('\\',"\\\\");
+		text.replace('"',"\\\"");
+		text.replace('\n',"\\n");
+		text.replace('\r',"\\r");
+		text.replace('\t',"\\t");
+		value.append('"').append(text).append('"');
+	} else if(v.isArray()) {
+		value.append('[');
+		OnceOnly first;
+		for(const QJsonValue& e: v.toArray()) {
+			if(!first())
+				value.append(',');
+			if(!appendValue(e,value))
+				return false;
+		}
+		value.append(']');
+	} else {
+		return false;
+	}
+	return true;
+}
+
+void Server::compile(const QJsonObject& request,QLocalSocket& socket)
+{
+	reporter.startTiming();
+
+	const QString& format=request.value("format").toString("stl");
+
+	QString messages;
+	QTextStream out(&messages);
+	Reporter r(out);
+	QTemporaryFile file;
+	QString overrides;
+	QString error;
+	int result=EXIT_FAILURE;
+	if(!validFormat(format)) {
+		r.reportWarning(tr("'%1' is not a supported format").arg(format));
+	} else if(!getOverrides(request,overrides,error)) {
+		r.reportWarning(error);
+	} else {
+		file.setFileTemplate(QDir::tempPath()+"/rapcad-XXXXXX."+format);
+		if(!file.open()) {
+			r.reportWarning(tr("unable to create '%1': %2").arg(file.fileTemplate(),file.errorString()));
+		} else {
+			file.close();
+			Worker w(r);
+			w.setup(request.value("file").toString(),file.fileName(),false);
+			w.setSource(request.value("source").toString());
+			w.setOverrides(overrides);
+			result=w.evaluate();
+		}
+	}
+	out.flush();
+
+	QByteArray data;
+	if(result==EXIT_SUCCESS && file.open())
+		data=file.readAll();
+
+	QJsonObject reply;
+	reply.insert("status",result==EXIT_SUCCESS?"ok":"error");
+	reply.insert("format",format);
+	reply.insert("size",data.size());
+	reply.insert("messages",messages);
+	if(writeAll(socket,QJsonDocument(reply).toJson(QJsonDocument::Compact)+'\n'))
+		writeAll(socket,data);
+
+	reporter.reportTiming(tr("request"));
+	output.flush();
+}
+
+bool Server::writeAll(QLocalSocket& socket,const QByteArray& data)
+{
+	/* Write in chunks so that large results are streamed to the client
+	 * rather than buffered in their entirety by the socket */
+	for(qsizetype i=0; i<data.size(); i+=chunkSize) {
+		if(socket.write(data.mid(i,chunkSize))<0)
+			return false;
+		while(socket.bytesToWrite()>0)
+			if(!socket.waitForBytesWritten(-1))
+				return false;
+	}
+	return true;
+}
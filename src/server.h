@@ -0,0 +1,48 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "strategy.h"
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QLocalSocket>
+#include <QString>
+
+class Server : public Strategy
+{
+	Q_DECLARE_TR_FUNCTIONS(Server)
+	Q_DISABLE_COPY_MOVE(Server)
+public:
+	explicit Server(Reporter&);
+	~Server() override = default;
+	void setup(const QString&);
+	int evaluate() override;
+private:
+	bool handleRequest(QLocalSocket&);
+	void compile(const QJsonObject&,QLocalSocket&);
+	static bool validFormat(const QString&);
+	static bool getOverrides(const QJsonObject&,QString&,QString&);
+	static bool appendValue(const QJsonValue&,QString&);
+	static bool writeAll(QLocalSocket&,const QByteArray&);
+
+	QString serverName;
+};
+
+#endif // SERVER_H
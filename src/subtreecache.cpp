@@ -0,0 +1,142 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "subtreecache.h"
+#include "evaluationsettings.h"
+#include "node/pointsnode.h"
+#include "node/primitivenode.h"
+#include "node/productnode.h"
+#include "nodeprinter.h"
+#include <QCryptographicHash>
+#include <QMutexLocker>
+
+SubtreeKeys::SubtreeKeys()
+{
+}
+
+QByteArray SubtreeKeys::getKey(const Node& n)
+{
+	const QMutexLocker locker(&mutex);
+	/* Print the exact values, numbers that only differ below the printed
+	 * precision would otherwise give two subtrees the same key */
+	const EvaluationSettings& exact=EvaluationSettings::current().withNumberFormat(NumberFormats::Rational);
+	const EvaluationSettings::Scope numbers(exact);
+	return calculateKey(n);
+}
+
+QByteArray SubtreeKeys::calculateKey(const Node& n)
+{
+	auto it=keys.constFind(&n);
+	if(it!=keys.constEnd())
+		return it.value();
+
+	/* The node printer does not describe the geometry of these nodes so
+	 * their text can't be used to identify them */
+	QByteArray key;
+	if(dynamic_cast<const ProductNode*>(&n) || dynamic_cast<const PointsNode*>(&n)) {
+		keys.insert(&n,key);
+		return key;
+	}
+
+	QString text;
+	QTextStream out(&text);
+	NodePrinter p(out);
+	p.setShallow(true);
+	n.accept(p);
+	p.releasePrimitives();
+	out.flush();
+
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(text.toUtf8());
+	bool cacheable=true;
+	for(Node* c: n.getChildren()) {
+		const QByteArray& k=calculateKey(*c);
+		if(k.isEmpty())
+			cacheable=false;
+		hash.addData(k);
+	}
+	if(cacheable)
+		key=hash.result();
+
+	keys.insert(&n,key);
+	return key;
+}
+
+void SubtreeKeys::dispose(const Node& n)
+{
+	const auto* pn=dynamic_cast<const PrimitiveNode*>(&n);
+	if(pn)
+		delete pn->getPrimitive();
+	for(Node* c: n.getChildren())
+		dispose(*c);
+}
+
+SubtreeCache::SubtreeCache() :
+	hits(0)
+{
+}
+
+SubtreeCache::~SubtreeCache()
+{
+	qDeleteAll(primitives);
+	primitives.clear();
+}
+
+Primitive* SubtreeCache::fetch(const Node& n,SubtreeKeys& keys,QByteArray& key)
+{
+	key.clear();
+	/* Leaves are as cheap to evaluate as they are to identify */
+	if(n.childCount()==0)
+		return nullptr;
+
+	/* Two subtrees that print the same describe the same geometry, which
+	 * is what makes a subtree independent of the values that differ
+	 * between evaluations */
+	const QByteArray& subtree=keys.getKey(n);
+	if(subtree.isEmpty())
+		return nullptr;
+
+	/* Nodes such as rotate_extrude keep their fragments rather than
+	 * printing them, so include the level of detail they were created at */
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(subtree);
+	hash.addData(EvaluationSettings::current().getLevelOfDetail().toUtf8());
+	key=hash.result();
+
+	Primitive* cached=primitives.value(key);
+	if(!cached)
+		return nullptr;
+
+	/* The primitives of the subtree won't be evaluated */
+	SubtreeKeys::dispose(n);
+	++hits;
+	return cached->copy();
+}
+
+void SubtreeCache::store(const QByteArray& key,Primitive* pr)
+{
+	if(key.isEmpty() || !pr || primitives.contains(key))
+		return;
+
+	primitives.insert(key,pr->copy());
+}
+
+int SubtreeCache::getHits() const
+{
+	return hits;
+}
@@ -0,0 +1,76 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SUBTREECACHE_H
+#define SUBTREECACHE_H
+
+#include "node.h"
+#include "primitive.h"
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+
+/**
+ * @brief Identifies subtrees by the printed text of their nodes. The key of
+ * each node is calculated from its own text and the keys of its children,
+ * and is remembered for as long as the tree is being evaluated, so that
+ * every node is only printed once however deep it is nested.
+ */
+class SubtreeKeys
+{
+	Q_DISABLE_COPY_MOVE(SubtreeKeys)
+public:
+	SubtreeKeys();
+	/**
+	 * @brief The key of the subtree, or an empty key when the printed text
+	 * of the subtree does not identify its geometry.
+	 */
+	QByteArray getKey(const Node&);
+	/**
+	 * @brief Delete the primitives of a subtree which won't be evaluated.
+	 */
+	static void dispose(const Node&);
+private:
+	QByteArray calculateKey(const Node&);
+	QMutex mutex;
+	QHash<const Node*,QByteArray> keys;
+};
+
+class SubtreeCache
+{
+	Q_DISABLE_COPY_MOVE(SubtreeCache)
+public:
+	SubtreeCache();
+	~SubtreeCache();
+	/**
+	 * @brief Fetch the result of a previous evaluation of an identical
+	 * subtree, and dispose of the primitives of the subtree when there is
+	 * one.
+	 * @param key Set to the key under which the result of evaluating the
+	 * subtree should be stored, or left empty if it can't be cached.
+	 * @return A copy of the cached result, or nullptr if there is none.
+	 */
+	Primitive* fetch(const Node&,SubtreeKeys&,QByteArray& key);
+	void store(const QByteArray&,Primitive*);
+	int getHits() const;
+private:
+	QHash<QByteArray,Primitive*> primitives;
+	int hits;
+};
+
+#endif // SUBTREECACHE_H
@@ -0,0 +1,131 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sweep.h"
+#include "builtincreator.h"
+#include "scriptcache.h"
+#include "subtreecache.h"
+#include "worker.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QRegularExpression>
+#include <contrib/qtcompat.h>
+
+Sweep::Sweep(Reporter& r) : Strategy(r)
+{
+}
+
+void Sweep::setup(const QString& i,const QString& t,const QString& o)
+{
+	inputFile=i;
+	tableFile=t;
+	outputFile=o;
+}
+
+bool Sweep::readTable()
+{
+	QFile f(tableFile);
+	if(!f.open(QFile::ReadOnly|QFile::Text)) {
+		reporter.reportFileMissingError(tableFile);
+		return false;
+	}
+
+	/* The first line of the table names the parameters, each line after
+	 * that gives their values for one variant. Values are expressions so
+	 * any containing spaces must be quoted. */
+	QTextStream in(&f);
+	int line=0;
+	while(!in.atEnd()) {
+		const QString& text=in.readLine().trimmed();
+		++line;
+		if(text.isEmpty()||text.startsWith('#'))
+			continue;
+
+		const QStringList& values=QProcess::splitCommand(text);
+		if(names.isEmpty()) {
+			names=values;
+			continue;
+		}
+		if(values.size()!=names.size()) {
+			reporter.reportWarning(tr("table line %1 should contain %2 values").arg(line).arg(names.size()));
+			continue;
+		}
+		rows.append(values);
+	}
+	return true;
+}
+
+QString Sweep::getOutputFile(const QStringList& values) const
+{
+	/* Name each result after the values used to create it, e.g. the
+	 * output part.stl becomes part_10_20.stl */
+	static const QRegularExpression unsafe("[^A-Za-z0-9.+-]+");
+	const QFileInfo info(outputFile);
+	QString name=info.completeBaseName();
+	for(const auto& v: values)
+		name.append("_"+QString(v).replace(unsafe,"-"));
+
+	return info.dir().filePath(name+"."+info.suffix());
+}
+
+int Sweep::evaluate()
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	if(!readTable())
+		return EXIT_FAILURE;
+
+	BuiltinCreator::getInstance(reporter);
+
+	/* Libraries used by the script are parsed once for all variants */
+	auto& sc=ScriptCache::getInstance();
+	sc.enableCaches();
+
+	/* Geometry which does not depend on the swept parameters is identical
+	 * in every variant so only evaluate it once */
+	SubtreeCache subtrees;
+
+	int failed=0;
+	for(const auto& values: std::as_const(rows)) {
+		QString overrides;
+		for(auto i=0; i<names.size(); ++i)
+			overrides.append(QString("%1=%2;").arg(names.at(i),values.at(i)));
+
+		const QString& file=getOutputFile(values);
+		Worker w(reporter);
+		w.setup(inputFile,file,false);
+		w.setOverrides(overrides);
+		w.setSubtreeCache(&subtrees);
+		if(w.evaluate()!=EXIT_SUCCESS) {
+			++failed;
+			reporter.reportMessage(tr("%1: failed").arg(file));
+		} else {
+			reporter.reportMessage(tr("%1: succeeded").arg(file));
+		}
+	}
+
+	sc.disableCaches();
+
+	reporter.reportMessage(tr("Variants: %1 Failed: %2 Reused: %3 (%4ms)").arg(rows.size()).arg(failed)
+		.arg(subtrees.getHits()).arg(timer.elapsed()));
+	reporter.setReturnCode(failed?EXIT_FAILURE:EXIT_SUCCESS);
+	return reporter.getReturnCode();
+}
@@ -0,0 +1,47 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "strategy.h"
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class Sweep : public Strategy
+{
+	Q_DECLARE_TR_FUNCTIONS(Sweep)
+	Q_DISABLE_COPY_MOVE(Sweep)
+public:
+	explicit Sweep(Reporter&);
+	~Sweep() override = default;
+	void setup(const QString&,const QString&,const QString&);
+	int evaluate() override;
+private:
+	bool readTable();
+	QString getOutputFile(const QStringList&) const;
+
+	QString inputFile;
+	QString tableFile;
+	QString outputFile;
+	QStringList names;
+	QList<QStringList> rows;
+};
+
+#endif // SWEEP_H
@@ -18,6 +18,9 @@
 
 #include "syntaxhighlighter.h"
 #include "preferences.h"
+#include <QTextBlock>
+#include <QTextBlockUserData>
+#include <QTimer>
 #include <contrib/qtcompat.h>
 
 extern int lexerdestroy(yyscan_t);
@@ -28,9 +31,30 @@ extern void lexercomment(yyscan_t);
 extern void lexercodedoc(yyscan_t);
 extern int lexerget_leng(yyscan_t);
 static constexpr int YY_CONTINUE=1;
+/* How long a single pass over the document may lex blocks, in
+ * milliseconds, before the rest are left for later */
+static constexpr int passBudget=40;
+
+/* The formats of a block are kept with it, so that a block whose text
+ * and starting state have not changed can be highlighted again without
+ * running the lexer */
+class SyntaxHighlighter::BlockData : public QTextBlockUserData
+{
+public:
+	size_t hash;
+	int length;
+	int previousState;
+	int state;
+	bool usesModuleNames;
+	int moduleNamesRevision;
+	QList<QTextLayout::FormatRange> formats;
+};
 
 SyntaxHighlighter::SyntaxHighlighter(QTextDocument* parent) :
 	QSyntaxHighlighter(parent),
+	usesModuleNames(false),
+	moduleNamesRevision(0),
+	deferring(true),
 	startIndex(0),
 	scanner(nullptr)
 {
@@ -81,10 +105,79 @@ SyntaxHighlighter::SyntaxHighlighter(QTextDocument* parent) :
 void SyntaxHighlighter::setModuleNames(const QHash<QString,Module*>& names)
 {
 	moduleNames = names;
+	++moduleNamesRevision;
+}
+
+void SyntaxHighlighter::setTokenFormat(int start,int count,const QTextCharFormat& format)
+{
+	setFormat(start,count,format);
+	formats.append(QTextLayout::FormatRange{start,count,format});
+}
+
+bool SyntaxHighlighter::highlightCached(const QString& text)
+{
+	const auto* data=static_cast<BlockData*>(currentBlockUserData());
+	if(!data || data->length!=text.length() || data->hash!=qHash(text))
+		return false;
+	if(data->previousState!=previousBlockState())
+		return false;
+	if(data->usesModuleNames && data->moduleNamesRevision!=moduleNamesRevision)
+		return false;
+
+	for(const auto& f: data->formats)
+		setFormat(f.start,f.length,f.format);
+	setCurrentBlockState(data->state);
+	return true;
+}
+
+bool SyntaxHighlighter::deferBlock()
+{
+	if(!deferring)
+		return false;
+
+	/* A pass lasts until control returns to the event loop */
+	if(!pass.isValid()) {
+		pass.start();
+		QTimer::singleShot(0,this,[this]() {
+			pass.invalidate();
+		});
+		return false;
+	}
+	if(pass.elapsed()<passBudget)
+		return false;
+
+	/* Leave the block unformatted and carry the state through, the
+	 * pending blocks are lexed a chunk at a time from the event loop.
+	 * They are queued by number since an edit may delete the block */
+	if(pending.isEmpty())
+		QTimer::singleShot(0,this,&SyntaxHighlighter::highlightPending);
+	pending.append(currentBlock().blockNumber());
+	setCurrentBlockState(previousBlockState());
+	return true;
+}
+
+void SyntaxHighlighter::highlightPending()
+{
+	QElapsedTimer timer;
+	timer.start();
+	deferring=false;
+	while(!pending.isEmpty() && timer.elapsed()<passBudget) {
+		const QTextBlock b=document()->findBlockByNumber(pending.takeFirst());
+		if(b.isValid())
+			rehighlightBlock(b);
+	}
+	deferring=true;
+	if(!pending.isEmpty())
+		QTimer::singleShot(0,this,&SyntaxHighlighter::highlightPending);
 }
 
 void SyntaxHighlighter::highlightBlock(const QString& text)
 {
+	if(highlightCached(text) || deferBlock())
+		return;
+
+	formats.clear();
+	usesModuleNames=false;
 	startIndex=0;
 	lexerinit(&scanner,this,text);
 
@@ -106,6 +199,16 @@ void SyntaxHighlighter::highlightBlock(const QString& text)
 	while(nextToken());
 
 	lexerdestroy(scanner);
+
+	auto* data=new BlockData();
+	data->hash=qHash(text);
+	data->length=static_cast<int>(text.length());
+	data->previousState=previousBlockState();
+	data->state=currentBlockState();
+	data->usesModuleNames=usesModuleNames;
+	data->moduleNamesRevision=moduleNamesRevision;
+	data->formats=formats;
+	setCurrentBlockUserData(data);
 }
 
 int SyntaxHighlighter::nextToken()
@@ -129,21 +232,21 @@ int SyntaxHighlighter::getLineNumber() const
 void SyntaxHighlighter::buildIncludeStart()
 {
 	const int len=lexerget_leng(scanner);
-	setFormat(startIndex,len-1,keywordFormat);
+	setTokenFormat(startIndex,len-1,keywordFormat);
 	startIndex+=len;
 }
 
 void SyntaxHighlighter::buildIncludeFile(const QString&)
 {
 	const int len=lexerget_leng(scanner);
-	setFormat(startIndex,len,stringFormat);
+	setTokenFormat(startIndex,len,stringFormat);
 	startIndex+=len;
 }
 
 void SyntaxHighlighter::buildIncludePath(const QString&)
 {
 	const int len=lexerget_leng(scanner);
-	setFormat(startIndex,len,stringFormat);
+	setTokenFormat(startIndex,len,stringFormat);
 	startIndex+=len;
 }
 
@@ -155,14 +258,14 @@ void SyntaxHighlighter::buildIncludeFinish()
 void SyntaxHighlighter::buildUseStart()
 {
 	const int len=lexerget_leng(scanner);
-	setFormat(startIndex,len-1,keywordFormat);
+	setTokenFormat(startIndex,len-1,keywordFormat);
 	startIndex+=len;
 }
 
 int SyntaxHighlighter::buildUse(const QString&)
 {
 	const int len=lexerget_leng(scanner);
-	setFormat(startIndex,len,stringFormat);
+	setTokenFormat(startIndex,len,stringFormat);
 	return YY_CONTINUE;
 }
 
@@ -174,13 +277,13 @@ void SyntaxHighlighter::buildUseFinish()
 void SyntaxHighlighter::buildImportStart()
 {
 	const int len=lexerget_leng(scanner);
-	setFormat(startIndex,len-1,keywordFormat);
+	setTokenFormat(startIndex,len-1,keywordFormat);
 	startIndex+=len;
 }
 
 int SyntaxHighlighter::buildImport(const QString&)
 {
-	setFormat(startIndex,lexerget_leng(scanner),stringFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),stringFormat);
 	return YY_CONTINUE;
 }
 
@@ -191,176 +294,176 @@ void SyntaxHighlighter::buildImportFinish()
 
 int SyntaxHighlighter::buildModule()
 {
-	setFormat(startIndex,lexerget_leng(scanner),keywordFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),keywordFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildFunction()
 {
-	setFormat(startIndex,lexerget_leng(scanner),keywordFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),keywordFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildTrue()
 {
-	setFormat(startIndex,lexerget_leng(scanner),keywordFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),keywordFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildFalse()
 {
-	setFormat(startIndex,lexerget_leng(scanner),keywordFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),keywordFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildUndef()
 {
-	setFormat(startIndex,lexerget_leng(scanner),keywordFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),keywordFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildConst()
 {
-	setFormat(startIndex,lexerget_leng(scanner),keywordFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),keywordFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildParam()
 {
-	setFormat(startIndex,lexerget_leng(scanner),keywordFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),keywordFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildIf()
 {
-	setFormat(startIndex,lexerget_leng(scanner),keywordFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),keywordFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildAs()
 {
-	setFormat(startIndex,lexerget_leng(scanner),keywordFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),keywordFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildElse()
 {
-	setFormat(startIndex,lexerget_leng(scanner),keywordFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),keywordFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildFor()
 {
-	setFormat(startIndex,lexerget_leng(scanner),keywordFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),keywordFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildReturn()
 {
-	setFormat(startIndex,lexerget_leng(scanner),keywordFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),keywordFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildLessEqual()
 {
-	setFormat(startIndex,lexerget_leng(scanner),operatorFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),operatorFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildGreatEqual()
 {
-	setFormat(startIndex,lexerget_leng(scanner),operatorFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),operatorFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildEqual()
 {
-	setFormat(startIndex,lexerget_leng(scanner),operatorFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),operatorFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildNotEqual()
 {
-	setFormat(startIndex,lexerget_leng(scanner),operatorFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),operatorFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildAnd()
 {
-	setFormat(startIndex,lexerget_leng(scanner),operatorFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),operatorFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildOr()
 {
-	setFormat(startIndex,lexerget_leng(scanner),operatorFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),operatorFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildComponentwiseMultiply()
 {
-	setFormat(startIndex,lexerget_leng(scanner),operatorFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),operatorFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildComponentwiseDivide()
 {
-	setFormat(startIndex,lexerget_leng(scanner),operatorFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),operatorFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildPlusMinus()
 {
 	// this adjusts for 2 byte unicode char
-	setFormat(startIndex--,1,operatorFormat);
+	setTokenFormat(startIndex--,1,operatorFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildIncrement()
 {
-	setFormat(startIndex,lexerget_leng(scanner),operatorFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),operatorFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildDecrement()
 {
-	setFormat(startIndex,lexerget_leng(scanner),operatorFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),operatorFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildAddAssign()
 {
-	setFormat(startIndex,lexerget_leng(scanner),operatorFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),operatorFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildSubtractAssign()
 {
-	setFormat(startIndex,lexerget_leng(scanner),operatorFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),operatorFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildCrossProduct()
 {
-	setFormat(startIndex,lexerget_leng(scanner),operatorFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),operatorFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildNamespace()
 {
-	setFormat(startIndex,lexerget_leng(scanner),keywordFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),keywordFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildAppend()
 {
-	setFormat(startIndex,lexerget_leng(scanner),operatorFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),operatorFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildOperator(int)
 {
-	setFormat(startIndex,lexerget_leng(scanner),operatorFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),operatorFormat);
 	return YY_CONTINUE;
 }
 
@@ -377,66 +480,67 @@ int SyntaxHighlighter::buildByteOrderMark()
 int SyntaxHighlighter::buildIllegalChar(const QString& s)
 {
 	const int stringLen=static_cast<int>(s.length());
-	setFormat(startIndex,stringLen,errorFormat);
+	setTokenFormat(startIndex,stringLen,errorFormat);
 	startIndex-=(lexerget_leng(scanner)-stringLen);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildNumber(const QString&)
 {
-	setFormat(startIndex,lexerget_leng(scanner),numberFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),numberFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildNumberExp(const QString&)
 {
-	setFormat(startIndex,lexerget_leng(scanner),numberFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),numberFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildRational()
 {
-	setFormat(startIndex,lexerget_leng(scanner),numberFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),numberFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildRational(const QString&)
 {
-	setFormat(startIndex,lexerget_leng(scanner),numberFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),numberFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildIdentifier(const QString& i)
 {
+	usesModuleNames=true;
 	if(moduleNames.contains(i))
-		setFormat(startIndex,lexerget_leng(scanner),moduleFormat);
+		setTokenFormat(startIndex,lexerget_leng(scanner),moduleFormat);
 	return YY_CONTINUE;
 }
 
 void SyntaxHighlighter::buildStringStart()
 {
 	const int len=lexerget_leng(scanner);
-	setFormat(startIndex,len,stringFormat);
+	setTokenFormat(startIndex,len,stringFormat);
 	startIndex+=len;
 }
 
 void SyntaxHighlighter::buildString(QChar)
 {
 	const int len=lexerget_leng(scanner);
-	setFormat(startIndex,len,stringFormat);
+	setTokenFormat(startIndex,len,stringFormat);
 	startIndex+=len;
 }
 
 void SyntaxHighlighter::buildString(const QString& s)
 {
 	const int stringLen=static_cast<int>(s.length());
-	setFormat(startIndex,stringLen,stringFormat);
+	setTokenFormat(startIndex,stringLen,stringFormat);
 	startIndex+=stringLen;
 }
 
 int SyntaxHighlighter::buildStringFinish()
 {
-	setFormat(startIndex,lexerget_leng(scanner),stringFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),stringFormat);
 	return YY_CONTINUE;
 }
 
@@ -444,14 +548,14 @@ void SyntaxHighlighter::buildCommentStart()
 {
 	setCurrentBlockState(static_cast<int>(BlockStates::Comment));
 	const int len=lexerget_leng(scanner);
-	setFormat(startIndex,len,commentFormat);
+	setTokenFormat(startIndex,len,commentFormat);
 	startIndex+=len;
 }
 
 void SyntaxHighlighter::buildComment(const QString& s)
 {
 	const int stringLen=static_cast<int>(s.length());
-	setFormat(startIndex,stringLen,commentFormat);
+	setTokenFormat(startIndex,stringLen,commentFormat);
 	startIndex+=stringLen;
 }
 
@@ -459,21 +563,21 @@ void SyntaxHighlighter::buildCommentFinish()
 {
 	setCurrentBlockState(static_cast<int>(BlockStates::Initial));
 	const int len=lexerget_leng(scanner);
-	setFormat(startIndex,len,commentFormat);
+	setTokenFormat(startIndex,len,commentFormat);
 	startIndex+=len;
 }
 
 int SyntaxHighlighter::buildCodeDocStart()
 {
 	setCurrentBlockState(static_cast<int>(BlockStates::CodeDoc));
-	setFormat(startIndex,lexerget_leng(scanner),codeDocFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),codeDocFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildCodeDoc(const QString& s)
 {
 	const int stringLen=static_cast<int>(s.length());
-	setFormat(startIndex,stringLen,codeDocFormat);
+	setTokenFormat(startIndex,stringLen,codeDocFormat);
 	/* Need to adjust back the index because this is a token and thus
 	 * index is incremented in the NextToken() call */
 	startIndex-=(lexerget_leng(scanner)-stringLen);
@@ -483,26 +587,26 @@ int SyntaxHighlighter::buildCodeDoc(const QString& s)
 void SyntaxHighlighter::buildCodeDoc()
 {
 	const int len=lexerget_leng(scanner);
-	setFormat(startIndex,len,codeDocFormat);
+	setTokenFormat(startIndex,len,codeDocFormat);
 	startIndex+=len;
 }
 
 int SyntaxHighlighter::buildCodeDocParam(const QString&)
 {
-	setFormat(startIndex,lexerget_leng(scanner),codeDocParamFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),codeDocParamFormat);
 	return YY_CONTINUE;
 }
 
 int SyntaxHighlighter::buildCodeDocFinish()
 {
 	setCurrentBlockState(static_cast<int>(BlockStates::Initial));
-	setFormat(startIndex,lexerget_leng(scanner),codeDocFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),codeDocFormat);
 	return YY_CONTINUE;
 }
 
 void SyntaxHighlighter::buildWhiteSpaceError()
 {
-	setFormat(startIndex,lexerget_leng(scanner),errorFormat);
+	setTokenFormat(startIndex,lexerget_leng(scanner),errorFormat);
 }
 
 void SyntaxHighlighter::buildWhiteSpace()
@@ -21,8 +21,11 @@
 
 #include "abstracttokenbuilder.h"
 #include "module.h"
+#include <QElapsedTimer>
 #include <QHash>
+#include <QList>
 #include <QSyntaxHighlighter>
+#include <QTextLayout>
 using yyscan_t = void*;
 
 class SyntaxHighlighter : public QSyntaxHighlighter, private AbstractTokenBuilder
@@ -39,7 +42,12 @@ private:
 		Comment,
 		CodeDoc
 	};
+	class BlockData;
 
+	void setTokenFormat(int,int,const QTextCharFormat&);
+	bool highlightCached(const QString&);
+	bool deferBlock();
+	void highlightPending();
 	int nextToken() override;
 	int getPosition() const override;
 	int getLineNumber() const override;
@@ -120,6 +128,12 @@ private:
 	QTextCharFormat codeDocFormat;
 	QTextCharFormat codeDocParamFormat;
 	QHash<QString,Module*> moduleNames;
+	QList<QTextLayout::FormatRange> formats;
+	bool usesModuleNames;
+	int moduleNamesRevision;
+	QElapsedTimer pass;
+	bool deferring;
+	QList<int> pending;
 	int startIndex;
 	yyscan_t scanner;
 };
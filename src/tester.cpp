@@ -18,17 +18,22 @@
 #ifdef USE_INTEGTEST
 
 #include "asciidocprinter.h"
+#include "batch.h"
 #include "booleanvalue.h"
 #include "builtincreator.h"
 #include "cachemanager.h"
 #include "export.h"
 #include "comparer.h"
 #include "geometryevaluator.h"
+#include "importcache.h"
+#include "interactive.h"
 #include "module/cubemodule.h"
 #include "module/squaremodule.h"
 #include "nodeevaluator.h"
 #include "nodeprinter.h"
 #include "preferences.h"
+#include "scriptcache.h"
+#include "server.h"
 #include "tester.h"
 #include "treeevaluator.h"
 #include "treeprinter.h"
@@ -36,8 +41,13 @@
 #include "ui/console.h"
 #include <QApplication>
 #include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QLineEdit>
+#include <QLocalSocket>
 #include <QMenu>
+#include <QTemporaryDir>
+#include <QThread>
 #include <QTimer>
 #include <QtTest/QTest>
 #include <boost/version.hpp>
@@ -198,6 +208,14 @@ int Tester::evaluate()
 			}
 		}
 	}
+	interactiveTest();
+#if USE_CGAL
+	massPropertiesTest();
+	serverTest();
+	batchTest();
+	importCacheTest();
+#endif
+	scriptCacheTest();
 	reporter.setReturnCode(failcount);
 
 	reporter.stopTiming("testing");
@@ -241,6 +259,282 @@ int Tester::evaluate()
 	return reporter.getReturnCode();
 }
 
+void Tester::interactiveTest()
+{
+	writeHeader("000_interactive",++testcount);
+
+	/* A command that fails within a module must leave the session as it
+	 * was, so that the commands after it still see the globals */
+	QString session;
+	QTextStream sessionstream(&session);
+	Reporter sessionreport(sessionstream);
+	Interactive i(sessionreport);
+	i.execCommand("a=2;");
+	i.execCommand("module m(){ assert(false); }");
+	i.execCommand("m();");
+	i.execCommand("b=a+1;");
+	i.execCommand("module n(){ writeln(b*a*7); }");
+	i.execCommand("n();");
+	sessionstream.flush();
+
+	if(session.split('\n').contains("42")) {
+		writePass();
+		passcount++;
+	} else {
+		writeFail();
+		failcount++;
+	}
+}
+
+#if USE_CGAL
+void Tester::massPropertiesTest()
+{
+	writeHeader("000_mass_properties",++testcount);
+
+	/* The mass properties are only reported as messages, so check them
+	 * for a cube whose values are exact */
+	QString messages;
+	QTextStream messagestream(&messages);
+	Reporter massreport(messagestream);
+	Script s(massreport);
+	s.parse("volume$(mass=true)cube(6);");
+	TreeEvaluator te(massreport);
+	s.accept(te);
+	const QScopedPointer<Node> n(te.getRootNode());
+	NodeEvaluator ne(massreport);
+	n->accept(ne);
+	delete ne.getResult();
+	messagestream.flush();
+
+	const QStringList lines=messages.split('\n');
+	if(lines.contains("Volume: 216") &&
+		lines.contains("Center of Mass: [3,3,3]") &&
+		lines.contains("Surface Area: 216") &&
+		lines.contains("Inertia: [[1296,0,0],[0,1296,0],[0,0,1296]]")) {
+		writePass();
+		passcount++;
+	} else {
+		writeFail();
+		failcount++;
+	}
+}
+#endif
+
+#if USE_CGAL
+static QJsonObject serverRequest(const QString& name,const QJsonObject& request,QString& data)
+{
+	QLocalSocket socket;
+	/* The server may not be listening yet */
+	for(auto i=0; i<100; ++i) {
+		socket.connectToServer(name);
+		if(socket.waitForConnected(1000))
+			break;
+		QThread::msleep(50);
+	}
+	socket.write(QJsonDocument(request).toJson(QJsonDocument::Compact)+'\n');
+	socket.waitForBytesWritten(-1);
+	while(socket.state()==QLocalSocket::ConnectedState)
+		socket.waitForReadyRead(1000);
+	const QByteArray& reply=socket.readAll();
+	const auto header=reply.indexOf('\n');
+	data=reply.mid(header+1);
+	return QJsonDocument::fromJson(reply.left(header)).object();
+}
+
+void Tester::serverTest()
+{
+	writeHeader("000_server",++testcount);
+
+	const QString& name=QString("rapcad-tester-%1").arg(QCoreApplication::applicationPid());
+	QString log;
+	QTextStream logstream(&log);
+	Reporter logreport(logstream);
+	Server server(logreport);
+	server.setup(name);
+	/* The server blocks while it waits for connections, so it is given
+	 * a thread of its own rather than one from the pool */
+	QThread* thread=QThread::create([&server](){ server.evaluate(); });
+	thread->start();
+
+	/* The format is used in the name of the output file so anything that
+	 * is not an export format has to be rejected */
+	QString data;
+	const QJsonObject& rejected=serverRequest(name,{
+		{"source","cube(1);"},
+		{"format","../../rapcad"}
+	},data);
+
+	/* Numbers have to arrive as numbers rather than strings */
+	const QJsonObject& parameters=serverRequest(name,{
+		{"source","n=0;writeln(n+1);cube(n);"},
+		{"format","stl"},
+		{"parameters",QJsonObject{{"n",2}}}
+	},data);
+
+	serverRequest(name,{{"quit",true}},data);
+	thread->wait();
+	delete thread;
+
+	const QStringList messages=parameters.value("messages").toString().split('\n');
+	if(rejected.value("status").toString()=="error" &&
+		rejected.value("messages").toString().contains("not a supported format") &&
+		parameters.value("status").toString()=="ok" &&
+		messages.contains("3") && data.contains("solid")) {
+		writePass();
+		passcount++;
+	} else {
+		writeFail();
+		failcount++;
+	}
+}
+#endif
+
+void Tester::batchTest()
+{
+	writeHeader("000_batch",++testcount);
+
+	/* The jobs run concurrently, the reports of each must be attributed
+	 * to its own job and the failures counted in the return code */
+	const QTemporaryDir dir;
+	const QStringList sources {
+		"writeln(\"first job\");cube(1);",
+		"writeln(\"second job\");cube(2);",
+		"assert(false);"
+	};
+	QFile manifest(dir.filePath("manifest.txt"));
+	if(manifest.open(QIODevice::WriteOnly|QIODevice::Text)) {
+		QTextStream m(&manifest);
+		for(auto i=0; i<sources.size(); ++i) {
+			QFile script(dir.filePath(QString("job%1.rcad").arg(i)));
+			if(script.open(QIODevice::WriteOnly|QIODevice::Text))
+				script.write(sources.at(i).toUtf8());
+			m << QString("job%1.rcad job%1.stl").arg(i) << Qt::endl;
+		}
+	}
+	manifest.close();
+
+	QString messages;
+	QTextStream messagestream(&messages);
+	Reporter batchreport(messagestream);
+	Batch b(batchreport);
+	b.setup(manifest.fileName());
+	const int result=b.evaluate();
+	messagestream.flush();
+	CacheManager::getInstance().disableCaches();
+
+	/* The messages of each job are reported just before its result */
+	const auto first=messages.indexOf("first job");
+	const auto firstResult=messages.indexOf("job0.stl: succeeded");
+	const auto second=messages.indexOf("second job");
+	const auto secondResult=messages.indexOf("job1.stl: succeeded");
+	if(result==EXIT_FAILURE &&
+		first>=0 && first<firstResult &&
+		firstResult<second && second<secondResult &&
+		messages.contains("job2.stl: failed") &&
+		messages.contains("Compiled: 3 Failed: 1")) {
+		writePass();
+		passcount++;
+	} else {
+		writeFail();
+		failcount++;
+	}
+}
+
+#if USE_CGAL
+static void writeFile(const QString& path,const QByteArray& content)
+{
+	QFile file(path);
+	if(file.open(QIODevice::WriteOnly)) {
+		file.write(content);
+		file.close();
+	}
+}
+
+void Tester::importCacheTest()
+{
+	writeHeader("000_import_cache",++testcount);
+
+	/* An imported script is reused until it, or any script that it uses,
+	 * is edited */
+	const QTemporaryDir dir;
+	const QFileInfo mainInfo(dir.filePath("main.rcad"));
+	const QFileInfo partInfo(dir.filePath("part.rcad"));
+	writeFile(dir.filePath("lib.rcad"),"module part(){cube(1);}");
+	writeFile(partInfo.absoluteFilePath(),"use <lib.rcad>\npart();");
+	writeFile(mainInfo.absoluteFilePath(),"import <part.rcad> as p;\np();");
+
+	auto& ic=ImportCache::getInstance();
+	ic.enableCaches();
+
+	Script s(*nullreport);
+	s.parse(mainInfo);
+	TreeEvaluator te(*nullreport);
+	s.accept(te);
+	const QScopedPointer<Node> n(te.getRootNode());
+	NodeEvaluator ne(*nullreport);
+	n->accept(ne);
+	delete ne.getResult();
+
+	Primitive* reused=ic.fetch(partInfo,*nullreport);
+	const bool stored=reused!=nullptr;
+	delete reused;
+
+	writeFile(dir.filePath("lib.rcad"),"module part(){cube(2);}");
+	Primitive* stale=ic.fetch(partInfo,*nullreport);
+	const bool invalidated=stale==nullptr;
+	delete stale;
+
+	ic.flushCaches();
+	ic.disableCaches();
+
+	if(stored && invalidated) {
+		writePass();
+		passcount++;
+	} else {
+		writeFail();
+		failcount++;
+	}
+}
+#endif
+
+void Tester::scriptCacheTest()
+{
+	writeHeader("000_script_cache",++testcount);
+
+	/* A script that fails to parse must not be cached, otherwise its
+	 * errors would not be reported again when it is next used */
+	const QTemporaryDir dir;
+	const QFileInfo info(dir.filePath("broken.rcad"));
+	QFile file(info.absoluteFilePath());
+	if(file.open(QIODevice::WriteOnly)) {
+		file.write("cube(;");
+		file.close();
+	}
+
+	auto& sc=ScriptCache::getInstance();
+	sc.enableCaches();
+	int reported=0;
+	for(auto i=0; i<2; ++i) {
+		QString messages;
+		QTextStream messagestream(&messages);
+		Reporter r(messagestream);
+		Script* s=sc.fetch(info,r);
+		messagestream.flush();
+		if(s && s->hasErrors() && messages.contains("Line 1"))
+			++reported;
+		sc.release(s);
+	}
+	sc.disableCaches();
+
+	if(reported==2) {
+		writePass();
+		passcount++;
+	} else {
+		writeFail();
+		failcount++;
+	}
+}
+
 void Tester::runTestPhase(Module* m,int testphase,int& modulecount)
 {
 	QString multithread_nullout;
@@ -47,6 +47,14 @@ private:
 	void exportTest(Primitive* p,const QFileInfo&,const QFileInfo&,const QString&);
 #endif
 	void runTestPhase(Module*,int,int&);
+	void interactiveTest();
+#if USE_CGAL
+	void massPropertiesTest();
+	void serverTest();
+	void batchTest();
+	void importCacheTest();
+#endif
+	void scriptCacheTest();
 	void builtinsTest();
 	void consoleTest();
 	void renderingTest();
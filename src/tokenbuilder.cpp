@@ -23,7 +23,7 @@
 static constexpr int YY_NULL=0;
 extern void lexerinit(yyscan_t*,AbstractTokenBuilder*,const QString&);
 extern void lexerinit(yyscan_t*,AbstractTokenBuilder*,const QFileInfo&);
-extern int lexerdestroy(yyscan_t);
+extern void lexerdestroy(yyscan_t);
 extern void lexerinclude(yyscan_t);
 extern int lexerlex(yyscan_t);
 extern char* lexerget_text(yyscan_t);
@@ -37,7 +37,8 @@ TokenBuilder::TokenBuilder(Reporter& r) :
 	position(0),
 	reporter(r),
 	parser(nullptr),
-	scanner(nullptr)
+	scanner(nullptr),
+	errors(false)
 {
 }
 
@@ -51,6 +52,11 @@ void TokenBuilder::setParser(YYSTYPE* p)
 	parser=p;
 }
 
+bool TokenBuilder::hasErrors() const
+{
+	return errors;
+}
+
 TokenBuilder::TokenBuilder(Reporter& r,const QString& s) : TokenBuilder(r)
 {
 	lexerinit(&scanner,this,s);
@@ -108,6 +114,7 @@ bool TokenBuilder::openfile(QFileInfo f)
 	FILE* fd=fopen(QFile::encodeName(fullpath),"r");
 	if(!fd) {
 		reporter.reportFileMissingError(fullpath);
+		errors=true;
 		return false;
 	}
 	openfiles.append(fd);
@@ -326,6 +333,7 @@ int TokenBuilder::buildByteOrderMark()
 int TokenBuilder::buildIllegalChar(const QString&)
 {
 	reporter.reportLexicalError(*this,lexerget_text(scanner));
+	errors=true;
 	return YY_NULL;
 }
 
@@ -104,6 +104,7 @@ public:
 	void buildFileFinish() override;
 	QString getToken() const override;
 	void setParser(union YYSTYPE*) override;
+	bool hasErrors() const;
 private:
 	TokenBuilder(Reporter& r);
 	bool openfile(QFileInfo);
@@ -117,6 +118,7 @@ private:
 	Reporter& reporter;
 	union YYSTYPE* parser;
 	yyscan_t scanner;
+	bool errors;
 };
 
 #endif // TOKENBUILDER_H
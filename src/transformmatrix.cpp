@@ -91,3 +91,23 @@ void TransformMatrix::setType(const TransformType& value)
 	type = value;
 }
 
+
+TransformMatrix TransformMatrix::operator*(const TransformMatrix& other) const
+{
+	TransformMatrix result;
+	for(int i=0; i<N; ++i) {
+		for(int j=0; j<M; ++j) {
+			decimal sum(0);
+			for(int k=0; k<N; ++k)
+				sum+=matrix(i,k)*other.matrix(k,j);
+			result.matrix(i,j)=sum;
+		}
+	}
+
+	/* Keep the fast forms when both sides share them, a product of
+	 * translations is still a translation and likewise for scaling */
+	if(type==other.type && (type==TransformType::Translation||type==TransformType::UniformScaling))
+		result.type=type;
+
+	return result;
+}
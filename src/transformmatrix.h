@@ -49,6 +49,7 @@ public:
 	const QGenericMatrix<N,M,decimal>& getValues() const;
 #endif
 	void setType(const TransformType& value);
+	TransformMatrix operator*(const TransformMatrix&) const;
 
 private:
 	QGenericMatrix<N,M,decimal> matrix;
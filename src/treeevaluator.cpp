@@ -21,27 +21,36 @@
 #include "complexvalue.h"
 #include "module/unionmodule.h"
 #include "rangevalue.h"
+#include "scriptcache.h"
 #include "valuefactory.h"
 #include "valueiterator.h"
 #include "vectorvalue.h"
 #include <QScopedPointer>
+#include <QtConcurrent>
 
 TreeEvaluator::TreeEvaluator(Reporter& r) :
 	reporter(r),
 	context(nullptr),
 	layout(nullptr),
 	descendDone(false),
+	importing(false),
 	rootNode(nullptr)
 {
+	ValueFactory::getInstance().pushValues();
 }
 
 TreeEvaluator::~TreeEvaluator()
 {
-	ValueFactory::getInstance().cleanupValues();
+	ValueFactory::getInstance().popValues();
 	qDeleteAll(scopeLookup);
 	scopeLookup.clear();
-	qDeleteAll(imports);
 	imports.clear();
+	qDeleteAll(parsedImports);
+	parsedImports.clear();
+	auto& sc=ScriptCache::getInstance();
+	for(Script* s: std::as_const(cachedImports))
+		sc.release(s);
+	cachedImports.clear();
 	qDeleteAll(modules);
 	modules.clear();
 	delete context;
@@ -200,6 +209,7 @@ void TreeEvaluator::visit(const Function& func)
 
 void TreeEvaluator::descend(Scope* scp)
 {
+	parseImports(scp);
 	for(Declaration* d: scp->getDeclarations()) {
 		auto* i=dynamic_cast<ScriptImport*>(d);
 		if(i)
@@ -357,6 +367,11 @@ void TreeEvaluator::visit(const AssignStatement& stmt)
 		}
 		default: {
 			Expression* expression = stmt.getExpression();
+			/* Global assignments of the main script can be overridden by
+			 * the caller, this is how parameters are passed to a script
+			 * from outside. Those of the scripts it uses are left alone */
+			if(op==Operators::None && !overrides.isEmpty() && !importing && dynamic_cast<Script*>(context->getCurrentScope()))
+				expression=overrides.value(name,expression);
 			if(expression) {
 				expression->accept(*this);
 				result = context->getCurrentValue();
@@ -556,11 +571,66 @@ QFileInfo TreeEvaluator::getFullPath(const QString& file)
 	return QFileInfo(file); /* relative to working dir */
 }
 
+void TreeEvaluator::parseImports(Scope* scp)
+{
+	/* The scripts used by a scope are independent of each other so parse
+	 * them all in parallel up front, the visitor will then descend into
+	 * them in declaration order */
+	QList<const ScriptImport*> pending;
+	QList<QFileInfo> files;
+	for(Declaration* d: scp->getDeclarations()) {
+		auto* i=dynamic_cast<ScriptImport*>(d);
+		if(i && !imports.contains(i)) {
+			pending.append(i);
+			files.append(getFullPath(i->getImport()));
+		}
+	}
+	if(pending.size()<2)
+		return;
+
+	using Parsed=QPair<Script*,bool>;
+	const auto scripts=QtConcurrent::blockingMapped<QList<Parsed>>(files,[this](const QFileInfo& f) {
+		const Reporter::Scope reports(reporter);
+		Script* s=ScriptCache::getInstance().fetch(f,reporter);
+		if(s)
+			return Parsed(s,false);
+		s=new Script(reporter);
+		s->parse(f);
+		return Parsed(s,true);
+	});
+
+	for(auto i=0; i<pending.size(); ++i) {
+		const Parsed& p=scripts.at(i);
+		if(p.second)
+			parsedImports.append(p.first);
+		else
+			cachedImports.append(p.first);
+		imports.insert(pending.at(i),p.first);
+	}
+}
+
+Script* TreeEvaluator::parseImport(const QFileInfo& f)
+{
+	/* Scripts held by the script cache are shared between evaluations
+	 * so only the ones parsed here are owned by the evaluator */
+	Script* s=ScriptCache::getInstance().fetch(f,reporter);
+	if(s) {
+		cachedImports.append(s);
+		return s;
+	}
+
+	s=new Script(reporter);
+	s->parse(f);
+	parsedImports.append(s);
+	return s;
+}
+
 void TreeEvaluator::visit(const ModuleImport& mi)
 {
 	auto* mod=new ImportModule(reporter);
 	const QFileInfo& f=getFullPath(mi.getImport());
 	mod->setImport(f.absoluteFilePath());
+	importedFiles.append(f.absoluteFilePath());
 	mod->setName(mi.getName());
 	modules.append(mod);
 	//TODO global import args.
@@ -575,9 +645,12 @@ void TreeEvaluator::visit(const ScriptImport& sc)
 {
 	if(!descendDone) {
 		const QFileInfo& f=getFullPath(sc.getImport());
-		auto* s=new Script(reporter);
-		s->parse(f);
-		imports.insert(&sc,s);
+		importedFiles.append(f.absoluteFilePath());
+		Script* s=imports.value(&sc);
+		if(!s) {
+			s=parseImport(f);
+			imports.insert(&sc,s);
+		}
 		/* Now recursively descend any modules functions or script imports within
 		 * the imported script and add them to the main script */
 		const QDir& loc=f.absoluteDir();
@@ -591,6 +664,8 @@ void TreeEvaluator::visit(const ScriptImport& sc)
 	 * of the main script */
 	Script* scp=imports.value(&sc);
 	if(scp) {
+		const bool wasImporting=importing;
+		importing=true;
 		for(Declaration* d: scp->getDeclarations()) {
 			auto* i=dynamic_cast<ScriptImport*>(d);
 			if(i)
@@ -599,6 +674,7 @@ void TreeEvaluator::visit(const ScriptImport& sc)
 			if(a)
 				a->accept(*this);
 		}
+		importing=wasImporting;
 	}
 }
 
@@ -667,6 +743,62 @@ void TreeEvaluator::visit(Script& sc)
 
 }
 
+void TreeEvaluator::resume(Script& sc)
+{
+	/* A command that fails part way, such as on an assert within a module,
+	 * leaves the contexts and layouts it was using on the stacks. Record
+	 * where the global ones are so that they can be restored */
+	const qsizetype contexts=std::max<qsizetype>(contextStack.size(),1);
+	const qsizetype layouts=std::max<qsizetype>(layoutStack.size(),1);
+	const qsizetype locations=importLocations.size();
+	try {
+		continueWith(sc);
+	} catch(...) {
+		while(contextStack.size()>contexts)
+			finishContext();
+		while(layoutStack.size()>layouts)
+			finishLayout();
+		importLocations.resize(locations);
+		importing=false;
+		if(context)
+			context->setCurrentScope(layout->getScope());
+		throw;
+	}
+}
+
+void TreeEvaluator::continueWith(Script& sc)
+{
+	if(!context) {
+		sc.accept(*this);
+		return;
+	}
+
+	/* The layout and context of the first script carry on into this one,
+	 * so that lookups from the modules and functions declared earlier
+	 * still reach the global variables */
+	scopeLookup.remove(layout->getScope());
+	layout->setScope(&sc);
+	scopeLookup.insert(&sc,layout);
+
+	importLocations.push(sc.getFileLocation());
+	descendDone=false;
+	descend(&sc);
+	descendDone=true;
+
+	context->setCurrentScope(&sc);
+	context->setCurrentNodes(QList<Node*>());
+	context->setReturnValue(nullptr);
+	for(Declaration* d: sc.getDeclarations()) {
+		d->accept(*this);
+	}
+	importLocations.pop();
+
+	if(context->getReturnValue())
+		reporter.reportWarning(tr("return statement not valid inside global scope."));
+
+	rootNode=UnionModule::createUnion(context->getCurrentNodes());
+}
+
 void TreeEvaluator::visit(Product& p)
 {
 	Node* r=p.evaluate(context);
@@ -695,3 +827,17 @@ Node* TreeEvaluator::getRootNode() const
 {
 	return rootNode;
 }
+
+const QStringList& TreeEvaluator::getImportedFiles() const
+{
+	return importedFiles;
+}
+
+void TreeEvaluator::setOverrides(const Script& sc)
+{
+	for(Declaration* d: sc.getDeclarations()) {
+		auto* a=dynamic_cast<AssignStatement*>(d);
+		if(a && a->getOperation()==Operators::None)
+			overrides.insert(a->getVariable()->getName(),a->getExpression());
+	}
+}
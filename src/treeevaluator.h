@@ -53,6 +53,7 @@
 #include "variable.h"
 #include "vectorexpression.h"
 #include <QStack>
+#include <QStringList>
 
 class TreeEvaluator : public TreeVisitor
 {
@@ -92,12 +93,27 @@ public:
 	void visit(Product&) override;
 	void visit(Callback&) override;
 
+	/**
+	 * @brief Evaluate a script as a continuation of the scripts evaluated
+	 * before it, so that their variables, modules, functions and imports
+	 * remain visible to it.
+	 */
+	void resume(Script&);
 	Node* getRootNode() const;
+	void setOverrides(const Script&);
+	/**
+	 * @brief The absolute paths of the scripts and files imported by
+	 * declarations, directly or through other imported scripts.
+	 */
+	const QStringList& getImportedFiles() const;
 
 private:
+	void continueWith(Script&);
 	void startContext(Scope*);
 	void finishContext();
 	void descend(Scope*);
+	void parseImports(Scope*);
+	Script* parseImport(const QFileInfo&);
 	void startLayout(Scope*);
 	void finishLayout();
 	QFileInfo getFullPath(const QString&);
@@ -109,10 +125,15 @@ private:
 	QStack<Layout*> layoutStack;
 	QHash<Scope*,Layout*> scopeLookup;
 	bool descendDone;
+	bool importing;
 	Node* rootNode;
 	QList<ImportModule*> modules;
 	QHash<const ScriptImport*,Script*> imports;
+	QList<Script*> parsedImports;
+	QList<Script*> cachedImports;
+	QHash<QString,Expression*> overrides;
 	QStack<QDir> importLocations;
+	QStringList importedFiles;
 };
 
 #endif // TREEEVALUATOR_H
@@ -120,7 +120,9 @@ void GLView::setShowPrintArea(bool print)
 
 void GLView::setRenderer(Renderer* r)
 {
-	delete render;
+	/* A preview renderer is set again each time objects are appended */
+	if(r!=render)
+		delete render;
 	render=r;
 	update();
 }
@@ -266,8 +266,10 @@ void MainWindow::setupActions()
 	connect(ui->actionShowBase,&QAction::triggered,ui->view,&GLView::setShowBase);
 	connect(ui->actionShowPrintArea,&QAction::triggered,ui->view,&GLView::setShowPrintArea);
 	connect(ui->actionShowRulers,&QAction::triggered,ui->view,&GLView::setShowRulers);
+	connect(ui->actionPreview,&QAction::triggered,this,&MainWindow::compileAndPreview);
 	connect(ui->actionCompileAndRender,&QAction::triggered,this,&MainWindow::compileAndRender);
 	connect(ui->actionGenerateGcode,&QAction::triggered,this,&MainWindow::compileAndGenerate);
+	connect(ui->actionCancelCompile,&QAction::triggered,this,&MainWindow::cancelCompile);
 	connect(ui->actionPreferences,&QAction::triggered,this,&MainWindow::showPreferences);
 
 	connect(ui->actionExportImage,&QAction::triggered,this,&MainWindow::grabFrameBuffer);
@@ -350,7 +352,7 @@ QString MainWindow::getSaveFileName(QWidget* parent,const QString& caption,const
 
 void MainWindow::exportFile(const QString& type)
 {
-	if(!worker->resultAvailable()) {
+	if(!worker->exactResultAvailable()) {
 		QMessageBox::information(this,tr("Export"),
 			tr("You have to compile the script before you can export"));
 		return;
@@ -520,6 +522,7 @@ void MainWindow::setupConsole()
 	reporter=new Reporter(*output);
 	worker=new BackgroundWorker(*reporter);
 	connect(worker,&BackgroundWorker::done,this,&MainWindow::evaluationDone);
+	connect(worker,&BackgroundWorker::previewed,this,&MainWindow::evaluationPreviewed);
 
 	interact=new Interactive(*reporter);
 	c->setPrompt(Interactive::getPrompt());
@@ -713,17 +716,22 @@ CodeEditor* MainWindow::getEditor(int i)
 	return qobject_cast<CodeEditor*>(ui->tabWidget->widget(i));
 }
 
+void MainWindow::compileAndPreview()
+{
+	compileOrGenerate(false,true);
+}
+
 void MainWindow::compileAndRender()
 {
-	compileOrGenerate(false);
+	compileOrGenerate(false,false);
 }
 
 void MainWindow::compileAndGenerate()
 {
-	compileOrGenerate(true);
+	compileOrGenerate(true,false);
 }
 
-void MainWindow::compileOrGenerate(bool generate)
+void MainWindow::compileOrGenerate(bool generate,bool preview)
 {
 	if(maybeSave(true)) {
 		CodeEditor* e=currentEditor();
@@ -731,14 +739,32 @@ void MainWindow::compileOrGenerate(bool generate)
 		if(!file.isEmpty()) {
 			ui->view->setCompiling(!generate);
 			worker->setup(file,"",generate);
+			worker->setFastPreview(preview);
 
 			worker->evaluate();
+			ui->actionPreview->setEnabled(false);
 			ui->actionCompileAndRender->setEnabled(false);
 			ui->actionGenerateGcode->setEnabled(false);
+			ui->actionCancelCompile->setEnabled(true);
 		}
 	}
 }
 
+void MainWindow::cancelCompile()
+{
+	worker->cancel();
+	ui->actionCancelCompile->setEnabled(false);
+}
+
+void MainWindow::evaluationPreviewed()
+{
+	/* Show the objects that have finished while the rest are computed */
+	Renderer* r = worker->getPreviewRenderer();
+	if(!r) return;
+	ui->view->setRenderer(r);
+	ui->view->setCompiling(true);
+}
+
 void MainWindow::evaluationDone()
 {
 	if(worker->resultAvailable()) {
@@ -746,8 +772,10 @@ void MainWindow::evaluationDone()
 		ui->view->setRenderer(r);
 		worker->resultAccepted();
 	}
+	ui->actionPreview->setEnabled(true);
 	ui->actionCompileAndRender->setEnabled(true);
 	ui->actionGenerateGcode->setEnabled(true);
+	ui->actionCancelCompile->setEnabled(false);
 	ui->view->setCompiling(false);
 
 	ui->console->displayPrompt();
@@ -881,7 +909,7 @@ void MainWindow::flushCaches()
 void MainWindow::sendToCAM()
 {
 	const QString title=tr("Send to CAM");
-	if(!worker->resultAvailable()) {
+	if(!worker->exactResultAvailable()) {
 		QMessageBox::information(this,title, tr("You have to compile the script before you can export"));
 		return;
 	}
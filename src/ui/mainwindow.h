@@ -62,8 +62,11 @@ private slots:
 	bool closeCurrentFile();
 	bool closeFile(int);
 	void openFile();
+	void compileAndPreview();
 	void compileAndRender();
 	void compileAndGenerate();
+	void cancelCompile();
+	void evaluationPreviewed();
 	void evaluationDone();
 	void examplesListClicked(const QModelIndex&);
 	void setTabTitle(const QString&);
@@ -88,7 +91,7 @@ private slots:
 	void commitChanges();
 private:
 	void setTheme();
-	void compileOrGenerate(bool generate);
+	void compileOrGenerate(bool generate,bool preview);
 	void loadPreferences();
 	void savePreferences();
 	void setupLayout();
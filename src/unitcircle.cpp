@@ -0,0 +1,51 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "unitcircle.h"
+#include "evaluationsettings.h"
+#include "rmath.h"
+#include <QMutexLocker>
+
+UnitCircle& UnitCircle::getInstance()
+{
+	static UnitCircle instance;
+	return instance;
+}
+
+QVector<UnitCircle::Entry> UnitCircle::getPoints(int f,int n)
+{
+	/* The rounded values depend on the rounding settings, so they are
+	 * part of the key */
+	const auto& s=EvaluationSettings::current();
+	const int rounding=static_cast<int>(s.getFunctionRounding());
+	const Key key(f,qMakePair(rounding,s.getSignificandBits()));
+
+	const QMutexLocker locker(&mutex);
+	QVector<Entry>& table=tables[key];
+	if(table.size()<n) {
+		table.reserve(n);
+		const decimal& tau=r_tau();
+		for(auto i=static_cast<int>(table.size()); i<n; ++i) {
+			const decimal& phi=(tau*i)/f;
+			table.append(Entry{r_cos(phi),r_sin(phi)});
+		}
+	}
+	/* The table is implicitly shared so returning it is cheap, and any
+	 * later growth detaches it from the caller's copy */
+	return table;
+}
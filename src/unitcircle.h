@@ -0,0 +1,54 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNITCIRCLE_H
+#define UNITCIRCLE_H
+
+#include "decimal.h"
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+
+/**
+ * @brief A process wide table of the rounded points of the unit circle,
+ * so that primitives with the same number of fragments scale the same
+ * precomputed values rather than evaluating the trig functions again.
+ */
+class UnitCircle
+{
+	Q_DISABLE_COPY_MOVE(UnitCircle)
+public:
+	struct Entry {
+		decimal cos;
+		decimal sin;
+	};
+	static UnitCircle& getInstance();
+	/**
+	 * @brief Get at least the first n points of the circle divided into f
+	 * fragments i.e. the cos and sin of tau*i/f for each i less than n,
+	 * where n may be greater than f for spirals.
+	 */
+	QVector<Entry> getPoints(int f,int n);
+private:
+	UnitCircle() = default;
+	using Key = QPair<int,QPair<int,int>>;
+	QHash<Key,QVector<Entry>> tables;
+	QMutex mutex;
+};
+
+#endif // UNITCIRCLE_H
@@ -1,6 +1,11 @@
 #include "valuefactory.h"
 #include <QtGlobal>
 
+ValueFactory::ValueFactory()
+{
+	values.append(QSet<Value*>());
+}
+
 ValueFactory::~ValueFactory()
 {
 	cleanupValues();
@@ -14,7 +19,7 @@ ValueFactory& ValueFactory::getInstance()
 
 void ValueFactory::appendValue(Value* v)
 {
-	getInstance().values.append(v);
+	getInstance().values.last().insert(v);
 }
 
 Value& ValueFactory::createUndefined()
@@ -81,20 +86,31 @@ ComplexValue& ValueFactory::createComplex(Value& r,const QList<Value*>& i)
 	return *v;
 }
 
-void ValueFactory::cleanupValues()
+void ValueFactory::pushValues()
 {
-	//Optimisation clear by swapping
-	QList<Value*> deleteLater;
-	values.swap(deleteLater);
+	values.append(QSet<Value*>());
+}
+
+void ValueFactory::popValues()
+{
+	/* The values are taken off the stack before they are deleted, so
+	 * that deleting them does not have to search the set they are in */
+	QSet<Value*> deleteLater=values.takeLast();
+	if(values.isEmpty())
+		values.append(QSet<Value*>());
 	qDeleteAll(deleteLater);
 }
 
+void ValueFactory::cleanupValues()
+{
+	while(values.size()>1)
+		popValues();
+	popValues();
+}
+
 void ValueFactory::deleteValue(Value* v)
 {
-	if(values.empty()) return;
-#if QT_VERSION >= QT_VERSION_CHECK(4,4,0)
-	values.removeOne(v);
-#else
-	values.removeAll(v);
-#endif
+	for(auto it=values.rbegin(); it!=values.rend(); ++it)
+		if(it->remove(v))
+			return;
 }
@@ -10,6 +10,7 @@
 #include "value.h"
 #include "vectorvalue.h"
 #include <QList>
+#include <QSet>
 
 class ValueFactory
 {
@@ -17,6 +18,15 @@ class ValueFactory
 public:
 	static ValueFactory& getInstance();
 
+	/**
+	 * @brief Start a new set of values, the values created from now on
+	 * belong to it until it is popped.
+	 */
+	void pushValues();
+	/**
+	 * @brief Delete the values created since the matching pushValues.
+	 */
+	void popValues();
 	void cleanupValues();
 	void deleteValue(Value*);
 
@@ -30,10 +40,12 @@ public:
 	static ComplexValue& createComplex(Value&,const QList<Value*>&);
 	static IntervalValue& createInterval(Value&,Value&);
 private:
-	ValueFactory() = default;
+	ValueFactory();
 	~ValueFactory();
 	static void appendValue(Value*);
-	QList<Value*> values;
+	/* Evaluators nest, so each one owns the values on top of the stack
+	 * and the values of the outer ones are still in use */
+	QList<QSet<Value*>> values;
 };
 
 #endif // VALUEFACTORY_H
@@ -17,16 +17,21 @@
  */
 
 #include "worker.h"
+#include "evaluationsettings.h"
 #include "geometryevaluator.h"
 #include "nodeevaluator.h"
 #include "numbervalue.h"
+#include "polyhedron.h"
 #include "preferences.h"
+#include "previewevaluator.h"
+#include "previewrenderer.h"
 #include "product.h"
 #include "treeevaluator.h"
 
 #ifdef USE_CGAL
 #include "CGAL/exceptions.h"
 #include "cgalexport.h"
+#include "cgalprimitive.h"
 #include "cgalrenderer.h"
 #else
 #include "simplerenderer.h"
@@ -40,13 +45,25 @@ Worker::Worker(Reporter& r) :
 	previous(nullptr),
 	inputFile(""),
 	outputFile(""),
-	generate(false)
+	source(""),
+	overrides(""),
+	subtrees(nullptr),
+	generate(false),
+	fastPreview(false),
+	progress([this](Primitive& p) { preview(p); }),
+	previewPrimitive(nullptr),
+	previousPreview(nullptr),
+	previewRenderer(nullptr),
+	previewRestarted(false)
 {
 }
 
 Worker::~Worker()
 {
 	delete primitive;
+	destroyPreviews();
+	delete previewPrimitive;
+	qDeleteAll(previews);
 }
 
 void Worker::setup(const QString& i,const QString& o,bool g)
@@ -56,8 +73,43 @@ void Worker::setup(const QString& i,const QString& o,bool g)
 	generate=g;
 }
 
+void Worker::setSource(const QString& s)
+{
+	source=s;
+}
+
+void Worker::setOverrides(const QString& o)
+{
+	overrides=o;
+}
+
+void Worker::setSubtreeCache(SubtreeCache* s)
+{
+	subtrees=s;
+}
+
+void Worker::setFastPreview(bool p)
+{
+	fastPreview=p;
+}
+
 int Worker::evaluate()
 {
+	/* Capture the settings once so that they stay the same for the whole
+	 * evaluation even if the preferences change meanwhile */
+	const EvaluationSettings settings(fastPreview);
+	const EvaluationSettings::Scope scope(settings);
+	progress.reset();
+	const EvaluationProgress::Scope active(&progress);
+	const Reporter::Scope reports(reporter);
+	{
+		/* Objects left over from an evaluation that was cancelled are not
+		 * part of this one */
+		const QMutexLocker locker(&previewMutex);
+		qDeleteAll(previews);
+		previews.clear();
+		previewRestarted=true;
+	}
 	try {
 		reporter.startTiming();
 
@@ -75,6 +127,9 @@ int Worker::evaluate()
 #endif
 	} catch(const AssertException& e) {
 		reporter.reportMessage(e.getMessage());
+	} catch(const EvaluationProgress::Cancelled&) {
+		reporter.reportMessage(tr("Evaluation cancelled."));
+		updatePrimitive(nullptr);
 	} catch(...) {
 		resultFailed(tr("Unknown error."));
 	}
@@ -85,12 +140,27 @@ int Worker::evaluate()
 	return reporter.getReturnCode();
 }
 
+void Worker::cancel()
+{
+	/* Called from other threads while the evaluation is running, the
+	 * evaluators stop at their next check */
+	progress.cancel();
+}
+
 void Worker::primary()
 {
 	Script s(reporter);
-	s.parse(inputFile);
+	if(source.isEmpty())
+		s.parse(inputFile);
+	else
+		s.parse(source);
 
 	TreeEvaluator e(reporter);
+	Script o(reporter);
+	if(!overrides.isEmpty()) {
+		o.parse(overrides);
+		e.setOverrides(o);
+	}
 	s.accept(e);
 	output.flush();
 
@@ -213,10 +283,17 @@ bool Worker::resultAvailable()
 	return (primitive!=nullptr);
 }
 
+bool Worker::exactResultAvailable()
+{
+	/* A preview is only good enough to be looked at */
+	return (primitive!=nullptr && !fastPreview);
+}
+
 void Worker::resultAccepted()
 {
 	reporter.reportTiming(tr("compiling"));
 	destroyPrevious();
+	destroyPreviews();
 }
 
 void Worker::destroyPrevious()
@@ -225,6 +302,29 @@ void Worker::destroyPrevious()
 	previous=nullptr;
 }
 
+void Worker::destroyPreviews()
+{
+	delete previousPreview;
+	previousPreview=nullptr;
+	delete previewPrimitive;
+	previewPrimitive=nullptr;
+	previewRenderer=nullptr;
+}
+
+void Worker::addPreview(Primitive& p)
+{
+	/* The evaluation goes on to combine the object on this thread while
+	 * the view renders the copy, so they must not share any geometry */
+#ifdef USE_CGAL
+	auto* cp=dynamic_cast<CGALPrimitive*>(&p);
+	Primitive* c=cp?cp->clone():p.copy();
+#else
+	Primitive* c=p.copy();
+#endif
+	const QMutexLocker locker(&previewMutex);
+	previews.append(c);
+}
+
 void Worker::resultFailed(const QString& error)
 {
 	reporter.reportException(error);
@@ -237,9 +337,59 @@ void Worker::updatePrimitive(Primitive* pr)
 	primitive=pr;
 }
 
+Renderer* Worker::getPreviewRenderer()
+{
+	QList<Primitive*> finished;
+	bool restarted=false;
+	{
+		const QMutexLocker locker(&previewMutex);
+		finished.swap(previews);
+		restarted=previewRestarted;
+		previewRestarted=false;
+	}
+	if(finished.isEmpty()) return nullptr;
+
+	/* The view already has the renderer of this evaluation, so only the
+	 * objects that finished since it was last updated are rendered and
+	 * appended to it */
+	if(previewRenderer&&!restarted) {
+		previewPrimitive->appendChildren(finished);
+#ifdef USE_CGAL
+		try {
+			static_cast<CGALRenderer*>(previewRenderer)->append(finished);
+		} catch(const CGAL::Failure_exception&) {
+			return nullptr;
+		}
+#endif
+		return previewRenderer;
+	}
+
+	/* The renderer that is being replaced still refers to the current
+	 * preview, so it is only destroyed once the next one is accepted */
+	delete previousPreview;
+	previousPreview=previewPrimitive;
+	previewPrimitive=new Polyhedron();
+	previewPrimitive->appendChildren(finished);
+	previewRenderer=nullptr;
+#ifdef USE_CGAL
+	try {
+		previewRenderer=new CGALRenderer(reporter,*previewPrimitive);
+	} catch(const CGAL::Failure_exception&) {
+		/* Only the preview is abandoned, any failure of the result itself
+		 * is reported when the evaluation is done */
+		return nullptr;
+	}
+#else
+	previewRenderer=new SimpleRenderer(*previewPrimitive);
+#endif
+	return previewRenderer;
+}
+
 Renderer* Worker::getRenderer()
 {
 	if(!primitive) return nullptr;
+	if(fastPreview)
+		return new PreviewRenderer(reporter,*primitive);
 #ifdef USE_CGAL
 	try {
 
@@ -257,6 +407,17 @@ Renderer* Worker::getRenderer()
 
 NodeVisitor* Worker::getNodeVisitor()
 {
+	if(fastPreview)
+		return new PreviewEvaluator(reporter);
+
+	/* Sharing results between evaluations relies on the children being
+	 * evaluated one at a time */
+	if(subtrees) {
+		auto* ne=new NodeEvaluator(reporter);
+		ne->setSubtreeCache(subtrees);
+		return ne;
+	}
+
 	auto& p=Preferences::getInstance();
 	const int threads=p.getThreadPoolSize();
 	if(threads==0)
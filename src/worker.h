@@ -19,6 +19,7 @@
 #ifndef WORKER_H
 #define WORKER_H
 
+#include "evaluationprogress.h"
 #include "instance.h"
 #include "nodevisitor.h"
 #include "primitive.h"
@@ -26,7 +27,9 @@
 #include "reporter.h"
 #include "script.h"
 #include "strategy.h"
+#include "subtreecache.h"
 #include <QCoreApplication>
+#include <QMutex>
 
 class Worker : public Strategy
 {
@@ -36,14 +39,23 @@ public:
 	explicit Worker(Reporter&);
 	~Worker() override;
 	void setup(const QString&,const QString&,bool);
+	void setSource(const QString&);
+	void setOverrides(const QString&);
+	void setSubtreeCache(SubtreeCache*);
+	void setFastPreview(bool);
 	int evaluate() override;
+	void cancel();
 	void exportResult(const QString&);
 	bool resultAvailable();
+	bool exactResultAvailable();
 	void resultAccepted();
 	Renderer* getRenderer();
+	Renderer* getPreviewRenderer();
 protected:
 	virtual void update() {}
 	virtual void finish() {}
+	virtual void preview(Primitive&) {}
+	void addPreview(Primitive&);
 private:
 	NodeVisitor* getNodeVisitor();
 	Instance* addProductInstance(const QString&, Script&);
@@ -54,12 +66,24 @@ private:
 	void resultFailed(const QString&);
 	void updatePrimitive(Primitive*);
 	void destroyPrevious();
+	void destroyPreviews();
 
 	Primitive* primitive;
 	Primitive* previous;
 	QFileInfo inputFile;
 	QString outputFile;
+	QString source;
+	QString overrides;
+	SubtreeCache* subtrees;
 	bool generate;
+	bool fastPreview;
+	EvaluationProgress progress;
+	QMutex previewMutex;
+	QList<Primitive*> previews;
+	Primitive* previewPrimitive;
+	Primitive* previousPreview;
+	Renderer* previewRenderer;
+	bool previewRestarted;
 };
 
 #endif // WORKER_H
@@ -0,0 +1,179 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "zipstreamwriter.h"
+#include <QDataStream>
+#include <QDateTime>
+
+enum {
+	ZipVersion=20,
+	ZipFlags=0x0808, /* sizes in a data descriptor, utf-8 names */
+	ZipDeflated=8,
+	ChunkSize=0x10000
+};
+
+ZipStreamWriter::ZipStreamWriter(const QString& fileName) :
+	file(fileName),
+	stream(),
+	inEntry(false),
+	failed(false),
+	time(0),
+	date(0)
+{
+}
+
+ZipStreamWriter::~ZipStreamWriter()
+{
+	ZipStreamWriter::close();
+}
+
+bool ZipStreamWriter::open(OpenMode mode)
+{
+	if(!file.open(QIODevice::WriteOnly|QIODevice::Truncate))
+		return false;
+
+	const QDateTime& now=QDateTime::currentDateTime();
+	const QDate& d=now.date();
+	const QTime& t=now.time();
+	date=static_cast<quint16>(((d.year()-1980)<<9)|(d.month()<<5)|d.day());
+	time=static_cast<quint16>((t.hour()<<11)|(t.minute()<<5)|(t.second()/2));
+	failed=false;
+	return QIODevice::open(mode|QIODevice::Unbuffered);
+}
+
+void ZipStreamWriter::close()
+{
+	if(!isOpen())
+		return;
+	endEntry();
+	writeCentralDirectory();
+	file.close();
+	entries.clear();
+	QIODevice::close();
+}
+
+bool ZipStreamWriter::isSequential() const
+{
+	return true;
+}
+
+void ZipStreamWriter::beginEntry(const QString& name)
+{
+	endEntry();
+
+	Entry e{};
+	e.name=name.toUtf8();
+	e.offset=static_cast<quint32>(file.pos());
+	writeLocalHeader(e);
+	entries.append(e);
+
+	/* Raw deflate, the zip headers take the place of the zlib wrapper */
+	stream=z_stream();
+	deflateInit2(&stream,Z_DEFAULT_COMPRESSION,Z_DEFLATED,-MAX_WBITS,8,Z_DEFAULT_STRATEGY);
+	inEntry=true;
+}
+
+void ZipStreamWriter::endEntry()
+{
+	if(!inEntry)
+		return;
+	deflateInput(Z_FINISH);
+	deflateEnd(&stream);
+	inEntry=false;
+
+	Entry& e=entries.last();
+	e.compressedSize=static_cast<quint32>(file.pos()-e.offset-30-e.name.size());
+	e.size=static_cast<quint32>(stream.total_in);
+
+	QDataStream out(&file);
+	out.setByteOrder(QDataStream::LittleEndian);
+	out << quint32(0x08074b50) << e.crc << e.compressedSize << e.size;
+}
+
+qint64 ZipStreamWriter::readData(char*,qint64)
+{
+	return -1;
+}
+
+qint64 ZipStreamWriter::writeData(const char* data,qint64 len)
+{
+	if(!inEntry||failed)
+		return -1;
+
+	/* Small writes are gathered so that zlib is handed a chunk at a time */
+	input.append(data,static_cast<int>(len));
+	if(input.size()>=ChunkSize)
+		deflateInput(Z_NO_FLUSH);
+	return failed?-1:len;
+}
+
+void ZipStreamWriter::deflateInput(int flush)
+{
+	Entry& e=entries.last();
+	e.crc=static_cast<quint32>(crc32(e.crc,reinterpret_cast<const Bytef*>(input.constData()),static_cast<uInt>(input.size())));
+
+	stream.next_in=reinterpret_cast<Bytef*>(input.data());
+	stream.avail_in=static_cast<uInt>(input.size());
+	char output[ChunkSize];
+	do {
+		stream.next_out=reinterpret_cast<Bytef*>(output);
+		stream.avail_out=ChunkSize;
+		deflate(&stream,flush);
+		const qint64 have=ChunkSize-stream.avail_out;
+		if(file.write(output,have)!=have)
+			failed=true;
+	} while(stream.avail_out==0);
+	input.clear();
+}
+
+void ZipStreamWriter::writeLocalHeader(const Entry& e)
+{
+	QDataStream out(&file);
+	out.setByteOrder(QDataStream::LittleEndian);
+	out << quint32(0x04034b50) << quint16(ZipVersion) << quint16(ZipFlags)
+		<< quint16(ZipDeflated) << time << date
+		<< quint32(0) << quint32(0) << quint32(0)
+		<< quint16(e.name.size()) << quint16(0);
+	file.write(e.name);
+}
+
+void ZipStreamWriter::writeCentralHeader(const Entry& e)
+{
+	QDataStream out(&file);
+	out.setByteOrder(QDataStream::LittleEndian);
+	out << quint32(0x02014b50) << quint16(ZipVersion) << quint16(ZipVersion)
+		<< quint16(ZipFlags) << quint16(ZipDeflated) << time << date
+		<< e.crc << e.compressedSize << e.size
+		<< quint16(e.name.size()) << quint16(0) << quint16(0)
+		<< quint16(0) << quint16(0) << quint32(0) << e.offset;
+	file.write(e.name);
+}
+
+void ZipStreamWriter::writeCentralDirectory()
+{
+	const qint64 start=file.pos();
+	for(const auto& e: std::as_const(entries))
+		writeCentralHeader(e);
+	const qint64 size=file.pos()-start;
+
+	QDataStream out(&file);
+	out.setByteOrder(QDataStream::LittleEndian);
+	out << quint32(0x06054b50) << quint16(0) << quint16(0)
+		<< quint16(entries.size()) << quint16(entries.size())
+		<< quint32(size) << quint32(start) << quint16(0);
+}
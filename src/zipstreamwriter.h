@@ -0,0 +1,76 @@
+/*
+ *   RapCAD - Rapid prototyping CAD IDE (www.rapcad.org)
+ *   Copyright (C) 2010-2023 Giles Bathgate
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ZIPSTREAMWRITER_H
+#define ZIPSTREAMWRITER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QIODevice>
+#include <QList>
+#include <zlib.h>
+
+/**
+ * @brief Writes a zip archive one entry at a time. Data written to the
+ * device is deflated into the current entry as it arrives, so that an
+ * entry never has to be held in memory in full. The sizes and checksum
+ * of an entry follow its data in a data descriptor.
+ */
+class ZipStreamWriter : public QIODevice
+{
+public:
+	explicit ZipStreamWriter(const QString& fileName);
+	~ZipStreamWriter() override;
+
+	bool open(OpenMode) override;
+	void close() override;
+	bool isSequential() const override;
+
+	/**
+	 * @brief Ends the current entry, if any, and starts a new one.
+	 */
+	void beginEntry(const QString& name);
+protected:
+	qint64 readData(char*,qint64) override;
+	qint64 writeData(const char*,qint64) override;
+private:
+	struct Entry {
+		QByteArray name;
+		quint32 crc;
+		quint32 compressedSize;
+		quint32 size;
+		quint32 offset;
+	};
+
+	void endEntry();
+	void deflateInput(int flush);
+	void writeLocalHeader(const Entry&);
+	void writeCentralHeader(const Entry&);
+	void writeCentralDirectory();
+
+	QFile file;
+	QList<Entry> entries;
+	QByteArray input;
+	z_stream stream;
+	bool inEntry;
+	bool failed;
+	quint16 time;
+	quint16 date;
+};
+
+#endif // ZIPSTREAMWRITER_H